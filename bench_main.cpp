@@ -0,0 +1,279 @@
+#include <sys/resource.h>
+
+#include <llvm/IR/Verifier.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "emitter.h"
+#include "frontend.h"
+#include "optimizer.h"
+#include "target.h"
+
+namespace {
+struct BenchOptions {
+  unsigned functions = 1000;
+  unsigned depth = 8;
+  unsigned chain = 32;
+  unsigned array = 64;
+  unsigned repeat = 1;
+  chovl::OptimizationLevel opt_level = chovl::OptimizationLevel::kO2;
+  std::string opt_flag = "-O2";
+  chovl::LexerKind lexer = chovl::LexerKind::kFlex;
+  bool dump = false;
+};
+
+struct Phase {
+  const char* name;
+  double seconds;
+};
+
+unsigned ParseCount(const std::string& arg, const std::string& prefix) {
+  std::string value = arg.substr(prefix.size());
+  try {
+    return std::stoul(value);
+  } catch (std::exception&) {
+    throw std::runtime_error("Invalid argument: " + arg);
+  }
+}
+
+BenchOptions ParseArguments(int argc, char** argv) {
+  BenchOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.starts_with("--functions=")) {
+      options.functions = ParseCount(arg, "--functions=");
+    } else if (arg.starts_with("--depth=")) {
+      options.depth = ParseCount(arg, "--depth=");
+    } else if (arg.starts_with("--chain=")) {
+      options.chain = ParseCount(arg, "--chain=");
+    } else if (arg.starts_with("--array=")) {
+      options.array = ParseCount(arg, "--array=");
+    } else if (arg.starts_with("--repeat=")) {
+      options.repeat = ParseCount(arg, "--repeat=");
+    } else if (arg == "-O0") {
+      options.opt_level = chovl::OptimizationLevel::kO0;
+      options.opt_flag = arg;
+    } else if (arg == "-O1") {
+      options.opt_level = chovl::OptimizationLevel::kO1;
+      options.opt_flag = arg;
+    } else if (arg == "-O2") {
+      options.opt_level = chovl::OptimizationLevel::kO2;
+      options.opt_flag = arg;
+    } else if (arg == "-O3") {
+      options.opt_level = chovl::OptimizationLevel::kO3;
+      options.opt_flag = arg;
+    } else if (arg == "-Os") {
+      options.opt_level = chovl::OptimizationLevel::kOs;
+      options.opt_flag = arg;
+    } else if (arg == "--lexer=flex") {
+      options.lexer = chovl::LexerKind::kFlex;
+    } else if (arg == "--lexer=fast") {
+      options.lexer = chovl::LexerKind::kFast;
+    } else if (arg == "--dump") {
+      options.dump = true;
+    } else {
+      throw std::runtime_error("Invalid argument: " + arg);
+    }
+  }
+
+  // A multi-assignment needs at least two values.
+  options.array = std::max(options.array, 2u);
+  options.functions = std::max(options.functions, 1u);
+  options.repeat = std::max(options.repeat, 1u);
+  return options;
+}
+
+std::string ChainTerm(unsigned i, unsigned array) {
+  switch (i % 5) {
+    case 0:
+      return "b * 3";
+    case 1:
+      return "(a - b)";
+    case 2:
+      return "v[" + std::to_string(i % array) + "]";
+    case 3:
+      return "a % 7";
+    default:
+      return std::to_string(i);
+  }
+}
+
+// Every generated function fills a local array with a multi-assignment,
+// computes a long chain of binary expressions, updates the result in `depth`
+// nested blocks and calls the previous function, so that none of them are
+// dead. `main` calls the last one.
+std::string GenerateProgram(const BenchOptions& options) {
+  std::string source;
+  for (unsigned f = 0; f < options.functions; ++f) {
+    source += "fn i32 func" + std::to_string(f) + "(i32 a, i32 b) {\n";
+
+    source += "  i32[" + std::to_string(options.array) + "] v;\n  v = {";
+    for (unsigned i = 0; i < options.array; ++i) {
+      source += (i == 0 ? "" : ", ") + std::to_string((f + i) % 100);
+    }
+    source += "};\n";
+
+    source += "  i32 x = a";
+    for (unsigned i = 0; i < options.chain; ++i) {
+      source += (i % 2 == 0 ? " + " : " - ") + ChainTerm(i, options.array);
+    }
+    source += ";\n";
+
+    for (unsigned d = 1; d <= options.depth; ++d) {
+      std::string indent(2 * d, ' ');
+      source += indent + "{\n" + indent + "  x = x + " + std::to_string(d) +
+                ";\n";
+    }
+    for (unsigned d = options.depth; d >= 1; --d) {
+      source += std::string(2 * d, ' ') + "}\n";
+    }
+
+    if (f == 0) {
+      source += "  x\n}\n\n";
+    } else {
+      source += "  x + func" + std::to_string(f - 1) + "(x, b)\n}\n\n";
+    }
+  }
+  source += "fn i32 main() = func" + std::to_string(options.functions - 1) +
+            "(1, 2);\n";
+  return source;
+}
+
+template <typename Function>
+double Time(Function&& function) {
+  auto start = std::chrono::steady_clock::now();
+  function();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Runs every phase of the compiler once over `source` and returns the time
+// each of them took. Parsing includes lexing, since the parser pulls tokens
+// from the lexer as it goes.
+std::vector<Phase> RunPhases(const std::string& source,
+                             const BenchOptions& options, size_t& tokens) {
+  std::vector<Phase> phases;
+  phases.push_back({"lex", Time([&] {
+                      tokens = chovl::Tokenize(source, options.lexer);
+                    })});
+
+  std::unique_ptr<chovl::AST> ast;
+  phases.push_back(
+      {"parse", Time([&] { ast = chovl::Parse(source, options.lexer); })});
+
+  llvm::Module& module = *ast->context().llvm_module;
+  std::unique_ptr<llvm::TargetMachine> target_machine =
+      chovl::CreateTargetMachine(options.opt_level);
+  chovl::ConfigureModule(module, *target_machine);
+  phases.push_back({"codegen", Time([&] { ast->codegen(); })});
+  chovl::SetTargetAttributes(module, *target_machine);
+
+  bool broken = false;
+  phases.push_back({"verify", Time([&] {
+                      broken = llvm::verifyModule(module, &llvm::errs());
+                    })});
+  if (broken) {
+    throw std::runtime_error("The generated module is invalid");
+  }
+
+  phases.push_back({"optimize", Time([&] {
+                      chovl::OptimizeModule(module, options.opt_level,
+                                            target_machine.get());
+                    })});
+
+  llvm::SmallString<128> object_path;
+  if (llvm::sys::fs::createTemporaryFile("chovl_bench", "o", object_path)) {
+    throw std::runtime_error("Could not create a temporary file");
+  }
+  phases.push_back({"emit", Time([&] {
+                      chovl::EmitNativeFile(
+                          module, *target_machine, std::string(object_path),
+                          llvm::CodeGenFileType::ObjectFile);
+                    })});
+  llvm::sys::fs::remove(object_path);
+  return phases;
+}
+
+void PrintReport(const BenchOptions& options, const std::string& source,
+                 size_t tokens, const std::vector<Phase>& phases) {
+  // The generated functions plus main.
+  double functions = options.functions + 1;
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  llvm::json::OStream json(llvm::outs(), 2);
+  json.object([&] {
+    json.attributeObject("config", [&] {
+      json.attribute("functions", int64_t{options.functions});
+      json.attribute("depth", int64_t{options.depth});
+      json.attribute("chain", int64_t{options.chain});
+      json.attribute("array", int64_t{options.array});
+      json.attribute("repeat", int64_t{options.repeat});
+      json.attribute("opt_level", options.opt_flag);
+      json.attribute("lexer", options.lexer == chovl::LexerKind::kFast
+                                  ? "fast"
+                                  : "flex");
+    });
+    json.attribute("source_bytes", static_cast<int64_t>(source.size()));
+    json.attribute("tokens", static_cast<int64_t>(tokens));
+    json.attributeArray("phases", [&] {
+      for (const Phase& phase : phases) {
+        json.object([&] {
+          json.attribute("name", phase.name);
+          json.attribute("seconds", phase.seconds);
+          json.attribute("tokens_per_second", tokens / phase.seconds);
+          json.attribute("functions_per_second", functions / phase.seconds);
+        });
+      }
+    });
+    // Linux reports the peak resident set size in KiB.
+    json.attribute("peak_rss_kib", static_cast<int64_t>(usage.ru_maxrss));
+  });
+  llvm::outs() << "\n";
+}
+}  // namespace
+
+// Generates a synthetic program, compiles it in-process and prints the time
+// spent in every phase of the compiler as JSON, so that the numbers can be
+// tracked over time.
+int main(int argc, char** argv) {
+  try {
+    BenchOptions options = ParseArguments(argc, argv);
+    std::string source = GenerateProgram(options);
+    if (options.dump) {
+      fwrite(source.data(), 1, source.size(), stdout);
+      return 0;
+    }
+
+    chovl::InitializeNativeTarget();
+    // Keep the fastest time of every phase over all repetitions.
+    size_t tokens = 0;
+    std::vector<Phase> best;
+    for (unsigned i = 0; i < options.repeat; ++i) {
+      std::vector<Phase> phases = RunPhases(source, options, tokens);
+      if (best.empty()) {
+        best = phases;
+        continue;
+      }
+      for (size_t p = 0; p < phases.size(); ++p) {
+        best[p].seconds = std::min(best[p].seconds, phases[p].seconds);
+      }
+    }
+    PrintReport(options, source, tokens, best);
+  } catch (std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
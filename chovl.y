@@ -1,19 +1,53 @@
 %{
 
-#include <iostream>
-
-extern int yylex();
-
-void yyerror(const char *s) {
-    std::cout << s << std::endl;
-}
+#include <memory>
+#include <stdexcept>
+#include <string>
 
 %}
 
+%define api.pure full
 %define parse.error verbose
 
+%parse-param {chovl::Scanner &scanner} {chovl::AST &ast}
+%lex-param {chovl::Scanner &scanner}
+
 %code requires {
 #include "ast.h"
+#include "token.h"
+
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+
+namespace chovl {
+class FastLexer;
+
+// The token source of one parse: the hand-written lexer when it is set,
+// otherwise the Flex scanner.
+struct Scanner {
+    yyscan_t flex_scanner = nullptr;
+    FastLexer *fast_lexer = nullptr;
+};
+}  // namespace chovl
+}
+
+%code {
+#include "fast_lexer.h"
+
+int chovl_flex_lex(YYSTYPE *yylval, yyscan_t scanner);
+
+static int yylex(YYSTYPE *yylval, chovl::Scanner &scanner) {
+    if (scanner.fast_lexer != nullptr) {
+        return scanner.fast_lexer->Lex(yylval);
+    }
+    return chovl_flex_lex(yylval, scanner.flex_scanner);
+}
+
+void yyerror(chovl::Scanner &scanner, chovl::AST &ast, const char *s) {
+    throw std::runtime_error(std::string("Syntax error: ") + s);
+}
 }
 
 %union {
@@ -30,15 +64,19 @@ void yyerror(const char *s) {
     chovl::VariableListNode *aggregate_assignable;
     chovl::Operator op;
     chovl::PrimitiveType primitive;
-    char *str;
+    chovl::TokenText text;
     char chr;
+    chovl::LoopNode *loop;
+    chovl::AttributeList *attributes;
+    chovl::StructInfo *structure;
+    chovl::FieldList *fields;
 }
 
 %type <assignable> assignable_value
 %type <node> cast_expression
 %type <node> binary_expression additive_expression multiplicative_expression
 %type <node> constant function_definition function_body function_prototype
-%type <node> function_declaration primary_expression expression block_expression function_call statement
+%type <node> function_declaration function_signature global_declaration global_definition primary_expression expression block_expression function_call statement
 %type <node> block block_statement conditional_expression binary_conditional_expression
 %type <aggregate> function_definition_list actual_param_list expression_list statement_list multi_expression
 %type <aggregate_assignable> multi_assignable_value assignable_value_list
@@ -46,13 +84,19 @@ void yyerror(const char *s) {
 %type <params> formal_param_list non_void_formal_param_list
 %type <type_id> type_identifier
 %type <primitive> primitive_type
+%type <loop> loop_statement
+%type <attributes> attribute_list
+%type <structure> struct_head
+%type <fields> field_list
 %type <op> additive_operator multiplicative_operator conditional_operator conditional_composition_operator
 
 %token OPEN_BRACK CLOSED_BRACK OPEN_SQ_BRACK CLOSED_SQ_BRACK
 %token OPEN_PAREN CLOSED_PAREN ARROW SEPARATOR COMMA REF
 %token KW_FN KW_I32 KW_F32 KW_AS KW_CHAR KW_IF KW_THEN KW_ELSE
+%token KW_WHILE KW_DO KW_FOR KW_IN RANGE AT KW_CONST KW_STRUCT DOT
+%token KW_F32X4 KW_F32X8 KW_I32X4 KW_I32X8
 %token OP_ASSIGN
-%token <str> IDENTIFIER STRING_LITERAL
+%token <text> IDENTIFIER STRING_LITERAL
 %token <i32> I32
 %token <f32> F32
 %token <chr> CHAR
@@ -63,44 +107,81 @@ void yyerror(const char *s) {
 
 %%
 
-program : function_definition_list { chovl::AST($1).codegen(); }
+program : function_definition_list { ast.set_root($1); }
         ;
 
-function_definition_list : function_definition { $$ = new chovl::ASTListNode(); $$->push_back($1); }
+function_definition_list : function_definition { $$ = ast.New<chovl::ASTListNode>(); $$->push_back($1); }
                          | function_definition_list function_definition { $1->push_back($2);  $$ = $1; }
+                         | struct_definition { $$ = ast.New<chovl::ASTListNode>(); }
+                         | function_definition_list struct_definition { $$ = $1; }
                          ;
 
-function_definition : function_declaration function_body { $$ = new chovl::FunctionDefNode($1, $2); }
+struct_definition : struct_head field_list CLOSED_BRACK { ast.DefineStruct($1, $2); }
+                  ;
+
+struct_head : KW_STRUCT IDENTIFIER OPEN_BRACK { $$ = ast.DeclareStruct($2, nullptr); }
+            | attribute_list KW_STRUCT IDENTIFIER OPEN_BRACK { $$ = ast.DeclareStruct($3, $1); }
+            ;
+
+field_list : type_identifier IDENTIFIER SEPARATOR { $$ = ast.New<chovl::FieldList>(); $$->push_back({ast.Intern($2), $1->get()}); }
+           | field_list type_identifier IDENTIFIER SEPARATOR { $1->push_back({ast.Intern($3), $2->get()}); $$ = $1; }
+           ;
+
+function_definition : function_declaration function_body { $$ = ast.New<chovl::FunctionDefNode>($1, $2); }
                     | function_prototype { $$ = $1; }
+                    | global_declaration { $$ = $1; }
                     ;
 
+global_declaration : global_definition { $$ = $1; }
+                   | KW_CONST global_definition { llvm::cast<chovl::GlobalVariableNode>($2)->set_constant(); $$ = $2; }
+                   ;
+
+global_definition : type_identifier IDENTIFIER SEPARATOR { $$ = ast.New<chovl::GlobalVariableNode>($1, ast.Intern($2), nullptr); }
+                  | type_identifier IDENTIFIER OP_ASSIGN expression SEPARATOR { auto *values = ast.New<chovl::ASTListNode>(); values->push_back($4); $$ = ast.New<chovl::GlobalVariableNode>($1, ast.Intern($2), values); }
+                  | type_identifier IDENTIFIER OP_ASSIGN OPEN_BRACK multi_expression CLOSED_BRACK SEPARATOR { $$ = ast.New<chovl::GlobalVariableNode>($1, ast.Intern($2), $5); }
+                  ;
+
 function_prototype : function_declaration SEPARATOR { $$ = $1; }
                    ;
 
-function_declaration : KW_FN IDENTIFIER OPEN_PAREN formal_param_list CLOSED_PAREN ARROW type_identifier { $$ = new chovl::FunctionDeclNode($2, $4, $7); }
-                     | KW_FN IDENTIFIER OPEN_PAREN formal_param_list CLOSED_PAREN { $$ = new chovl::FunctionDeclNode($2, $4, new chovl::TypeNode(chovl::Type(chovl::PrimitiveType::kNone, chovl::IndirectionType::kNone))); }
-                     | KW_FN type_identifier IDENTIFIER OPEN_PAREN formal_param_list CLOSED_PAREN { $$ = new chovl::FunctionDeclNode($3, $5, $2); }
+function_declaration : function_signature { $$ = $1; }
+                     | attribute_list function_signature { llvm::cast<chovl::FunctionDeclNode>($2)->set_attributes($1); $$ = $2; }
                      ;
 
+function_signature : KW_FN IDENTIFIER OPEN_PAREN formal_param_list CLOSED_PAREN ARROW type_identifier { $$ = ast.New<chovl::FunctionDeclNode>($2, $4, $7); }
+                   | KW_FN IDENTIFIER OPEN_PAREN formal_param_list CLOSED_PAREN { $$ = ast.New<chovl::FunctionDeclNode>($2, $4, ast.New<chovl::TypeNode>(chovl::Type(chovl::PrimitiveType::kNone, chovl::IndirectionType::kNone))); }
+                   | KW_FN type_identifier IDENTIFIER OPEN_PAREN formal_param_list CLOSED_PAREN { $$ = ast.New<chovl::FunctionDeclNode>($3, $5, $2); }
+                   ;
+
 formal_param_list : formal_param_list COMMA parameter { $1->push_back($3); $$ = $1; }
                   | non_void_formal_param_list { $$ = $1; }
-                  | { $$ = new chovl::ParameterListNode(); }
+                  | { $$ = ast.New<chovl::ParameterListNode>(); }
                   ;
 
-non_void_formal_param_list : parameter { $$ = new chovl::ParameterListNode(); $$->push_back($1); }
+non_void_formal_param_list : parameter { $$ = ast.New<chovl::ParameterListNode>(); $$->push_back($1); }
                            ;
 
-parameter : type_identifier IDENTIFIER { $$ = new chovl::ParameterNode($1, $2); }
+parameter : type_identifier IDENTIFIER { $$ = ast.New<chovl::ParameterNode>($1, ast.Intern($2)); }
+          | attribute_list type_identifier IDENTIFIER { $$ = ast.New<chovl::ParameterNode>($2, ast.Intern($3)); $$->set_attributes($1); }
           ;
 
 primitive_type : KW_I32 { $$ = chovl::PrimitiveType::kI32; }
                | KW_F32 { $$ = chovl::PrimitiveType::kF32; }
                | KW_CHAR { $$ = chovl::PrimitiveType::kChar; }
+               | KW_F32X4 { $$ = chovl::PrimitiveType::kF32x4; }
+               | KW_F32X8 { $$ = chovl::PrimitiveType::kF32x8; }
+               | KW_I32X4 { $$ = chovl::PrimitiveType::kI32x4; }
+               | KW_I32X8 { $$ = chovl::PrimitiveType::kI32x8; }
                ;
 
-type_identifier : primitive_type { $$ = new chovl::TypeNode(chovl::Type($1, chovl::IndirectionType::kNone)); }
-                | primitive_type OPEN_SQ_BRACK I32 CLOSED_SQ_BRACK { $$ = new chovl::TypeNode(chovl::Type($1, $3, chovl::IndirectionType::kNone)); }
-                | primitive_type REF { $$ = new chovl::TypeNode(chovl::Type($1, chovl::IndirectionType::kPointer)); }
+type_identifier : primitive_type { $$ = ast.New<chovl::TypeNode>(chovl::Type($1, chovl::IndirectionType::kNone)); }
+                | primitive_type OPEN_SQ_BRACK I32 CLOSED_SQ_BRACK { $$ = ast.New<chovl::TypeNode>(chovl::Type($1, $3, chovl::IndirectionType::kNone)); }
+                | primitive_type REF { $$ = ast.New<chovl::TypeNode>(chovl::Type($1, chovl::IndirectionType::kPointer)); }
+                | primitive_type OPEN_SQ_BRACK CLOSED_SQ_BRACK { $$ = ast.New<chovl::TypeNode>(chovl::Type::Slice($1)); }
+                | KW_STRUCT IDENTIFIER { $$ = ast.New<chovl::TypeNode>(chovl::Type(ast.GetStruct($2), chovl::IndirectionType::kNone)); }
+                | KW_STRUCT IDENTIFIER OPEN_SQ_BRACK I32 CLOSED_SQ_BRACK { $$ = ast.New<chovl::TypeNode>(chovl::Type(ast.GetStruct($2), $4, chovl::IndirectionType::kNone)); }
+                | KW_STRUCT IDENTIFIER REF { $$ = ast.New<chovl::TypeNode>(chovl::Type(ast.GetStruct($2), chovl::IndirectionType::kPointer)); }
+                | KW_STRUCT IDENTIFIER OPEN_SQ_BRACK CLOSED_SQ_BRACK { $$ = ast.New<chovl::TypeNode>(chovl::Type::Slice(ast.GetStruct($2))); }
                 ;
 
 function_body : OP_ASSIGN expression SEPARATOR { $$ = $2; }
@@ -111,29 +192,42 @@ block : block_expression { $$ = $1; }
       | block_statement { $$ = $1; }
       ;
 
-block_expression : OPEN_BRACK expression_list CLOSED_BRACK { $$ = new chovl::BlockNode($2); }
+block_expression : OPEN_BRACK expression_list CLOSED_BRACK { $$ = ast.New<chovl::BlockNode>($2); }
                  ;
 
-block_statement : OPEN_BRACK statement_list CLOSED_BRACK { $$ = new chovl::BlockNode($2, true); }
-                | OPEN_BRACK CLOSED_BRACK { $$ = new chovl::BlockNode(new chovl::ASTListNode()); }
+block_statement : OPEN_BRACK statement_list CLOSED_BRACK { $$ = ast.New<chovl::BlockNode>($2, true); }
+                | OPEN_BRACK CLOSED_BRACK { $$ = ast.New<chovl::BlockNode>(ast.New<chovl::ASTListNode>()); }
                 ;
 
 statement : expression SEPARATOR { $$ = $1; }
-          | type_identifier IDENTIFIER SEPARATOR { $$ = new chovl::VariableDeclarationNode($1, $2, nullptr); }
-          | type_identifier IDENTIFIER OP_ASSIGN expression SEPARATOR { $$ = new chovl::VariableDeclarationNode($1, $2, $4); }
-          | assignable_value OP_ASSIGN expression SEPARATOR { $$ = new chovl::AssignmentNode($1, $3); }
-          | assignable_value OP_ASSIGN OPEN_BRACK multi_expression CLOSED_BRACK SEPARATOR { $$ = new chovl::MultiAssignmentNode($1, $4); }
-          | multi_assignable_value OP_ASSIGN OPEN_BRACK multi_expression CLOSED_BRACK SEPARATOR { $$ = new chovl::MultiAssignmentNode($1, $4); }
+          | type_identifier IDENTIFIER SEPARATOR { $$ = ast.New<chovl::VariableDeclarationNode>($1, ast.Intern($2), nullptr); }
+          | type_identifier IDENTIFIER OP_ASSIGN expression SEPARATOR { $$ = ast.New<chovl::VariableDeclarationNode>($1, ast.Intern($2), $4); }
+          | assignable_value OP_ASSIGN expression SEPARATOR { $$ = ast.New<chovl::AssignmentNode>($1, $3); }
+          | OP_MUL assignable_value OP_ASSIGN expression SEPARATOR { $$ = ast.New<chovl::AssignmentNode>(ast.New<chovl::DereferenceNode>($2), $4); }
+          | assignable_value OP_ASSIGN OPEN_BRACK multi_expression CLOSED_BRACK SEPARATOR { $$ = ast.New<chovl::MultiAssignmentNode>($1, $4); }
+          | multi_assignable_value OP_ASSIGN OPEN_BRACK multi_expression CLOSED_BRACK SEPARATOR { $$ = ast.New<chovl::MultiAssignmentNode>($1, $4); }
           | block_statement { $$ = $1; }
-          | KW_IF primary_expression KW_THEN block_statement KW_ELSE block_statement { $$ = new chovl::CondStatementNode($2, $4, $6); }
-          | KW_IF primary_expression KW_THEN block_statement { $$ = new chovl::CondStatementNode($2, $4, nullptr); }
+          | KW_IF primary_expression KW_THEN block_statement KW_ELSE block_statement { $$ = ast.New<chovl::CondStatementNode>($2, $4, $6); }
+          | KW_IF primary_expression KW_THEN block_statement { $$ = ast.New<chovl::CondStatementNode>($2, $4, nullptr); }
+          | loop_statement { $$ = $1; }
+          | attribute_list loop_statement { $2->set_attributes($1); $$ = $2; }
           ;
 
-statement_list : statement { $$ = new chovl::ASTListNode(); $$->push_back($1); }
+loop_statement : KW_WHILE primary_expression KW_DO block_statement { $$ = ast.New<chovl::WhileLoopNode>($2, $4); }
+               | KW_FOR IDENTIFIER KW_IN primary_expression RANGE primary_expression KW_DO block_statement { $$ = ast.New<chovl::ForLoopNode>(ast.Intern($2), $4, $6, $8); }
+               ;
+
+attribute_list : AT IDENTIFIER { $$ = ast.New<chovl::AttributeList>(); $$->push_back({std::string($2)}); }
+               | AT IDENTIFIER OPEN_PAREN I32 CLOSED_PAREN { $$ = ast.New<chovl::AttributeList>(); $$->push_back({std::string($2), $4}); }
+               | attribute_list AT IDENTIFIER { $1->push_back({std::string($3)}); $$ = $1; }
+               | attribute_list AT IDENTIFIER OPEN_PAREN I32 CLOSED_PAREN { $1->push_back({std::string($3), $5}); $$ = $1; }
+               ;
+
+statement_list : statement { $$ = ast.New<chovl::ASTListNode>(); $$->push_back($1); }
                | statement_list statement { $1->push_back($2); $$ = $1; }
                ;
 
-expression_list : expression { $$ = new chovl::ASTListNode(); $$->push_back($1); }
+expression_list : expression { $$ = ast.New<chovl::ASTListNode>(); $$->push_back($1); }
                 | statement_list expression { $1->push_back($2); $$ = $1; }
                 ;
 
@@ -143,28 +237,29 @@ expression : binary_expression { $$ = $1; }
            ;
 
 cast_expression : primary_expression { $$ = $1; }
-                | primary_expression KW_AS type_identifier { $$ = new chovl::CastOpNode($3, $1); }
+                | primary_expression KW_AS type_identifier { $$ = ast.New<chovl::CastOpNode>($3, $1); }
                 ;
 
 multiplicative_expression : cast_expression { $$ = $1; }
-                          | multiplicative_expression multiplicative_operator cast_expression { $$ = new chovl::BinaryExprNode($2, $1, $3); }
+                          | multiplicative_expression multiplicative_operator cast_expression { $$ = ast.New<chovl::BinaryExprNode>($2, $1, $3); }
                           ;
 
 additive_expression : multiplicative_expression { $$ = $1; }
-                    | additive_expression additive_operator multiplicative_expression { $$ = new chovl::BinaryExprNode($2, $1, $3); }
+                    | additive_expression additive_operator multiplicative_expression { $$ = ast.New<chovl::BinaryExprNode>($2, $1, $3); }
                     ;
 
 binary_expression : additive_expression { $$ = $1; }
                   ;
 
-assignable_value : IDENTIFIER { $$ = new chovl::VariableNode($1); }
-                 | IDENTIFIER OPEN_SQ_BRACK expression CLOSED_SQ_BRACK { $$ = new chovl::ArrayAccessNode($1, $3); }
+assignable_value : IDENTIFIER { $$ = ast.New<chovl::VariableNode>(ast.Intern($1)); }
+                 | IDENTIFIER OPEN_SQ_BRACK expression CLOSED_SQ_BRACK { $$ = ast.New<chovl::ArrayAccessNode>(ast.Intern($1), $3); }
+                 | assignable_value DOT IDENTIFIER { $$ = ast.New<chovl::FieldAccessNode>($1, ast.Intern($3)); }
                  ;
 
 multi_assignable_value : OPEN_BRACK assignable_value_list CLOSED_BRACK { $$ = $2; }
                        ;
 
-assignable_value_list : assignable_value COMMA assignable_value { $$ = new chovl::VariableListNode(); $$->push_back($1); $$->push_back($3); }
+assignable_value_list : assignable_value COMMA assignable_value { $$ = ast.New<chovl::VariableListNode>(); $$->push_back($1); $$->push_back($3); }
                       | assignable_value_list COMMA assignable_value { $1->push_back($3); $$ = $1; }
                       ;
 
@@ -173,34 +268,35 @@ primary_expression : constant { $$ = $1; }
                    | function_call { $$ = $1; }
                    | block_expression { $$ = $1; }
                    | assignable_value { $$ = $1; }
-                   | KW_IF primary_expression KW_THEN primary_expression KW_ELSE primary_expression { $$ = new chovl::CondExprNode($2, $4, $6); }
-                   | REF assignable_value { $$ = new chovl::GetAddressNode($2); }
-                   | OP_MUL assignable_value { $$ = new chovl::DereferenceNode($2); }
+                   | KW_IF primary_expression KW_THEN primary_expression KW_ELSE primary_expression { $$ = ast.New<chovl::CondExprNode>($2, $4, $6); }
+                   | REF assignable_value { $$ = ast.New<chovl::GetAddressNode>($2); }
+                   | IDENTIFIER OPEN_SQ_BRACK expression RANGE expression CLOSED_SQ_BRACK { $$ = ast.New<chovl::SliceNode>(ast.Intern($1), $3, $5); }
+                   | OP_MUL assignable_value { $$ = ast.New<chovl::DereferenceNode>($2); }
                    ;
 
-binary_conditional_expression : conditional_expression conditional_composition_operator conditional_expression { $$ = new chovl::BinaryExprNode($2, $1, $3); }
-                              | binary_conditional_expression conditional_composition_operator conditional_expression { $$ = new chovl::BinaryExprNode($2, $1, $3); }
+binary_conditional_expression : conditional_expression conditional_composition_operator conditional_expression { $$ = ast.New<chovl::BinaryExprNode>($2, $1, $3); }
+                              | binary_conditional_expression conditional_composition_operator conditional_expression { $$ = ast.New<chovl::BinaryExprNode>($2, $1, $3); }
                               ;
 
-conditional_expression : primary_expression conditional_operator primary_expression { $$ = new chovl::BinaryExprNode($2, $1, $3); }
+conditional_expression : primary_expression conditional_operator primary_expression { $$ = ast.New<chovl::BinaryExprNode>($2, $1, $3); }
                        ;
 
-function_call : IDENTIFIER OPEN_PAREN actual_param_list CLOSED_PAREN { $$ = new chovl::FunctionCallNode($1, $3); }
-              | IDENTIFIER OPEN_PAREN CLOSED_PAREN { $$ = new chovl::FunctionCallNode($1, new chovl::ASTListNode()); }
+function_call : IDENTIFIER OPEN_PAREN actual_param_list CLOSED_PAREN { $$ = ast.New<chovl::FunctionCallNode>($1, $3); }
+              | IDENTIFIER OPEN_PAREN CLOSED_PAREN { $$ = ast.New<chovl::FunctionCallNode>($1, ast.New<chovl::ASTListNode>()); }
               ;
 
-actual_param_list : expression { $$ = new chovl::ASTListNode(); $$->push_back($1); }
+actual_param_list : expression { $$ = ast.New<chovl::ASTListNode>(); $$->push_back($1); }
                   | multi_expression { $$ = $1; }
                   ;
 
-multi_expression : expression COMMA expression { $$ = new chovl::ASTListNode(); $$->push_back($1); $$->push_back($3); }
+multi_expression : expression COMMA expression { $$ = ast.New<chovl::ASTListNode>(); $$->push_back($1); $$->push_back($3); }
                  | multi_expression COMMA expression { $1->push_back($3); $$ = $1; }
                  ;
 
-constant : F32 { $$ = new chovl::F32Node($1); }
-         | I32 { $$ = new chovl::I32Node($1); }
-         | CHAR { $$ = new chovl::CharNode($1); }
-         | STRING_LITERAL { $$ = new chovl::StringLiteralNode($1); }
+constant : F32 { $$ = ast.New<chovl::F32Node>($1); }
+         | I32 { $$ = ast.New<chovl::I32Node>($1); }
+         | CHAR { $$ = ast.New<chovl::CharNode>($1); }
+         | STRING_LITERAL { $$ = ast.New<chovl::StringLiteralNode>($1); }
          ;
 
 additive_operator : OP_ADD { $$ = $1; }
@@ -224,4 +320,64 @@ conditional_composition_operator : OP_OR  { $$ = $1; }
                                  | OP_AND { $$ = $1; }
                                  ;
 
-%%
\ No newline at end of file
+%%
+
+#include "frontend.h"
+#include "lexer.h"
+
+namespace chovl {
+
+std::unique_ptr<AST> Parse(std::string_view source, LexerKind lexer) {
+    auto ast = std::make_unique<AST>();
+    int result;
+    if (lexer == LexerKind::kFast) {
+        FastLexer fast_lexer(source);
+        Scanner scanner;
+        scanner.fast_lexer = &fast_lexer;
+        result = yyparse(scanner, *ast);
+    } else {
+        Scanner scanner;
+        if (yylex_init(&scanner.flex_scanner) != 0) {
+            throw std::runtime_error("Could not initialize the lexer");
+        }
+        yy_scan_bytes(source.data(), static_cast<int>(source.size()),
+                      scanner.flex_scanner);
+        try {
+            result = yyparse(scanner, *ast);
+        } catch (...) {
+            yylex_destroy(scanner.flex_scanner);
+            throw;
+        }
+        yylex_destroy(scanner.flex_scanner);
+    }
+
+    if (result != 0) {
+        throw std::runtime_error("Could not parse the input");
+    }
+    return ast;
+}
+
+size_t Tokenize(std::string_view source, LexerKind lexer) {
+    YYSTYPE value;
+    size_t tokens = 0;
+    if (lexer == LexerKind::kFast) {
+        FastLexer fast_lexer(source);
+        while (fast_lexer.Lex(&value) != 0) {
+            ++tokens;
+        }
+        return tokens;
+    }
+
+    yyscan_t scanner;
+    if (yylex_init(&scanner) != 0) {
+        throw std::runtime_error("Could not initialize the lexer");
+    }
+    yy_scan_bytes(source.data(), static_cast<int>(source.size()), scanner);
+    while (chovl_flex_lex(&value, scanner) != 0) {
+        ++tokens;
+    }
+    yylex_destroy(scanner);
+    return tokens;
+}
+
+}  // namespace chovl
@@ -1,8 +1,71 @@
 #include <cstdio>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "frontend.h"
+
+// Applies the compiler flags listed on a first line of the form
+// `// flags: -fbounds-check -ftail-calls=guaranteed` to `context`.
+void ApplyTestFlags(llvm::StringRef source, chovl::Context& context) {
+  llvm::StringRef line = source.take_until([](char c) { return c == '\n'; });
+  if (!line.consume_front("// flags:")) {
+    return;
+  }
+  llvm::SmallVector<llvm::StringRef, 4> flags;
+  line.split(flags, ' ', -1, false);
+  for (llvm::StringRef flag : flags) {
+    if (flag == "-fbounds-check") {
+      context.bounds_check = true;
+    } else if (flag == "-ftail-calls=none") {
+      context.tail_call_mode = chovl::TailCallMode::kNone;
+    } else if (flag == "-ftail-calls=auto") {
+      context.tail_call_mode = chovl::TailCallMode::kAuto;
+    } else if (flag == "-ftail-calls=guaranteed") {
+      context.tail_call_mode = chovl::TailCallMode::kGuaranteed;
+    } else {
+      throw std::runtime_error("Unknown test flag: " + flag.str());
+    }
+  }
+}
 
-#include "gen/parser.h"
+// Compiles `input_file_name` and prints the generated globals and functions
+// to `output_file_name`. A compile error is printed as a comment instead, so
+// tests can expect it in their gold file. Returns 0 unless a file could not
+// be opened.
+int CompileFile(const char* input_file_name, const char* output_file_name,
+                chovl::LexerKind lexer) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> source =
+      llvm::MemoryBuffer::getFile(input_file_name);
+  if (!source) {
+    fprintf(stderr, "Could not open input file: %s\n", input_file_name);
+    return 1;
+  }
 
-extern int yylex();
+  std::error_code error;
+  llvm::raw_fd_ostream out(output_file_name, error);
+  if (error) {
+    fprintf(stderr, "Could not open output file: %s\n", output_file_name);
+    return 1;
+  }
+
+  try {
+    std::unique_ptr<chovl::AST> ast = chovl::Parse((*source)->getBuffer(), lexer);
+    ApplyTestFlags((*source)->getBuffer(), ast->context());
+    ast->codegen();
+    ast->print(out);
+  } catch (std::exception& e) {
+    fprintf(stderr, "%s: %s\n", input_file_name, e.what());
+    out << "; error: " << e.what() << "\n";
+  }
+  return 0;
+}
 
 int CheckFiles(const char* test_name, FILE* output_file, FILE* gold_file) {
   int output_char = fgetc(output_file);
@@ -76,37 +139,40 @@ int main(int argc, char* argv[]) {
   char input_file_name[1024];
   char output_file_name[1024];
   char gold_file_name[1024];
+  // Both lexers must produce exactly the same program.
+  const chovl::LexerKind lexers[] = {chovl::LexerKind::kFlex,
+                                     chovl::LexerKind::kFast};
   for (int i = 1; i < argc; i++) {
-    sprintf(input_file_name, "%s.chv", argv[i]);
-    sprintf(output_file_name, "%s.ll", argv[i]);
-    sprintf(gold_file_name, "%s.gold", argv[i]);
-
-    FILE* gold_file = fopen(gold_file_name, "r");
+    for (chovl::LexerKind lexer : lexers) {
+      sprintf(input_file_name, "%s.chv", argv[i]);
+      sprintf(output_file_name,
+              lexer == chovl::LexerKind::kFast ? "%s.fast.ll" : "%s.ll",
+              argv[i]);
+      sprintf(gold_file_name, "%s.gold", argv[i]);
 
-    CHECK_OPEN(gold_file, "gold", gold_file_name, overall_result);
+      FILE* gold_file = fopen(gold_file_name, "r");
 
-    freopen(input_file_name, "r", stdin);
-    freopen(output_file_name, "w", stdout);
+      CHECK_OPEN(gold_file, "gold", gold_file_name, overall_result);
 
-    yyparse();
-
-    fclose(stdin);
-    fclose(stdout);
+      if (CompileFile(input_file_name, output_file_name, lexer) != 0) {
+        overall_result = 1;
+      }
 
-    FILE* output_file = fopen(output_file_name, "r");
-    if (output_file == NULL) {
-      fprintf(stderr, "Could not open output file for reading: %s\n",
-              output_file_name);
-      return 1;
-    }
+      FILE* output_file = fopen(output_file_name, "r");
+      if (output_file == NULL) {
+        fprintf(stderr, "Could not open output file for reading: %s\n",
+                output_file_name);
+        return 1;
+      }
 
-    int result = CheckFiles(input_file_name, output_file, gold_file);
+      int result = CheckFiles(input_file_name, output_file, gold_file);
 
-    fclose(output_file);
-    fclose(gold_file);
+      fclose(output_file);
+      fclose(gold_file);
 
-    if (result != 0) {
-      overall_result = 1;
+      if (result != 0) {
+        overall_result = 1;
+      }
     }
   }
 
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace chovl {
+
+// A bump-pointer allocator. Objects created with New are packed into large
+// blocks and are never freed individually; they all go away together with
+// the arena, which first runs the destructors of the objects that have one,
+// in reverse order of creation.
+class Arena {
+ public:
+  Arena() = default;
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+  ~Arena();
+
+  template <typename T, typename... Args>
+  T *New(Args &&...args) {
+    T *object = new (Allocate(sizeof(T), alignof(T)))
+        T(std::forward<Args>(args)...);
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      destructors_.push_back(
+          {object, [](void *p) { static_cast<T *>(p)->~T(); }});
+    }
+    return object;
+  }
+
+  // Copies `text` into the arena.
+  std::string_view CopyString(std::string_view text);
+
+ private:
+  struct Destructor {
+    void *object;
+    void (*destroy)(void *);
+  };
+
+  static constexpr size_t kBlockSize = 64 * 1024;
+
+  void *Allocate(size_t size, size_t alignment);
+
+  std::vector<std::unique_ptr<std::byte[]>> blocks_;
+  std::byte *cursor_ = nullptr;
+  std::byte *end_ = nullptr;
+  std::vector<Destructor> destructors_;
+};
+
+}  // namespace chovl
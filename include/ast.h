@@ -6,37 +6,106 @@
 
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
+#include "arena.h"
 #include "context.h"
 #include "operators.h"
 #include "scope.h"
 
 namespace chovl {
 
-// This class is never transmitted via a non-owning pointer, so all raw pointers
-// to a Node are owning.
+class AST;
+
+enum class NodeKind : uint8_t {
+  kStringLiteral,
+  kI32,
+  kF32,
+  kChar,
+  kBool,
+  kBinaryExpr,
+  kFunctionDecl,
+  kFunctionDef,
+  kFunctionCall,
+  kCastOp,
+  kBlock,
+  kVariableDeclaration,
+  kGlobalVariable,
+  kAssignment,
+  kMultiAssignment,
+  kCondExpr,
+  kCondStatement,
+  kWhileLoop,
+  kForLoop,
+  kGetAddress,
+  kSlice,
+  kASTList,
+  kDeadCode,
+  // Assignable nodes. The first ones can also be multi-assigned.
+  kVariable,
+  kVariableList,
+  kArrayAccess,
+  kFieldAccess,
+  kDereference,
+};
+
+// Nodes are allocated in the arena of their AST and are all released with
+// it, so pointers between nodes are non-owning. The kind tag replaces RTTI:
+// use llvm::isa, llvm::cast and llvm::dyn_cast on nodes.
 class ASTNode {
  public:
+  NodeKind kind() const { return kind_; }
+
   virtual llvm::Value *codegen(Context &context) = 0;
-  virtual ~ASTNode() = default;
+  // Called on the body of a function, and forwarded to the nodes whose value
+  // the function returns, so that calls among them can become tail calls.
+  virtual void mark_tail_position() {}
+  // Folds the constant subtrees below the node and returns the node that
+  // replaces it, which is the node itself unless it could be evaluated or
+  // pruned. Replacements are allocated in `ast`.
+  virtual ASTNode *fold(AST &ast) { return this; }
+
+ protected:
+  explicit ASTNode(NodeKind kind) : kind_(kind) {}
+  ~ASTNode() = default;
+
+ private:
+  NodeKind kind_;
 };
 
 class AssignableNode : public ASTNode {
  public:
+  static bool classof(const ASTNode *node) {
+    return node->kind() >= NodeKind::kVariable &&
+           node->kind() <= NodeKind::kDereference;
+  }
+
   virtual llvm::Value *assign(Context &context, llvm::Value *value) = 0;
   virtual llvm::Value *llvm_alloca(Context &context) = 0;
   virtual Type type(Context &context) = 0;
-  virtual ~AssignableNode() = default;
+  // Whether the node is a constant, or part of one.
+  virtual bool is_constant(Context &context) { return false; }
+
+ protected:
+  using ASTNode::ASTNode;
 };
 
 class MultiAssignableNode : public AssignableNode {
  public:
-  virtual llvm::Value *assign(Context &context, llvm::Value *value) = 0;
-  virtual llvm::Value *llvm_alloca(Context &context) = 0;
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kVariable ||
+           node->kind() == NodeKind::kVariableList;
+  }
+
   virtual llvm::Value *multi_assign(Context &context,
                                     std::vector<llvm::Value *> value) = 0;
-  virtual ~MultiAssignableNode() = default;
+
+ protected:
+  using AssignableNode::AssignableNode;
 };
 
 class ASTAggregateNode : public ASTNode {
@@ -46,12 +115,23 @@ class ASTAggregateNode : public ASTNode {
   }
   virtual std::vector<llvm::Value *> codegen_aggregate(Context &context) = 0;
   virtual void push_back(ASTNode *node) = 0;
-  virtual ~ASTAggregateNode() = default;
+  // Aggregates fold their elements in place.
+  ASTNode *fold(AST &ast) override = 0;
+
+ protected:
+  using ASTNode::ASTNode;
 };
 
+// A string literal is a null-terminated char array. Unless it initializes a
+// local array, it is read from a private constant in read-only data.
 class StringLiteralNode : public ASTNode {
  public:
-  explicit StringLiteralNode(const char *value) : value_(value) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kStringLiteral;
+  }
+
+  explicit StringLiteralNode(std::string_view value)
+      : ASTNode(NodeKind::kStringLiteral), value_(value) {}
 
   llvm::Value *codegen(Context &context) override;
 
@@ -61,9 +141,14 @@ class StringLiteralNode : public ASTNode {
 
 class I32Node : public ASTNode {
  public:
-  explicit I32Node(int32_t value) : value_(value) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kI32;
+  }
+
+  explicit I32Node(int32_t value) : ASTNode(NodeKind::kI32), value_(value) {}
 
   llvm::Value *codegen(Context &context) override;
+  int32_t value() const { return value_; }
 
  private:
   int32_t value_;
@@ -71,9 +156,14 @@ class I32Node : public ASTNode {
 
 class F32Node : public ASTNode {
  public:
-  explicit F32Node(float value) : value_(value) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kF32;
+  }
+
+  explicit F32Node(float value) : ASTNode(NodeKind::kF32), value_(value) {}
 
   llvm::Value *codegen(Context &context) override;
+  float value() const { return value_; }
 
  private:
   float value_;
@@ -81,25 +171,76 @@ class F32Node : public ASTNode {
 
 class CharNode : public ASTNode {
  public:
-  explicit CharNode(char value) : value_(value) {}
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kChar;
+  }
+
+  explicit CharNode(char value) : ASTNode(NodeKind::kChar), value_(value) {}
 
   llvm::Value *codegen(Context &context) override;
+  char value() const { return value_; }
 
  private:
   char value_;
 };
 
+// An i1 constant. There are no boolean literals in the source; these are
+// the folded results of comparisons.
+class BoolNode : public ASTNode {
+ public:
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kBool;
+  }
+
+  explicit BoolNode(bool value) : ASTNode(NodeKind::kBool), value_(value) {}
+
+  llvm::Value *codegen(Context &context) override;
+  bool value() const { return value_; }
+
+ private:
+  bool value_;
+};
+
+// What folding leaves of a node that has a part which can never run, like
+// the untaken branch of an `if` on a constant. The dead part is still
+// generated, into a function that is deleted again, so that a program has the
+// same errors whether or not it can be folded.
+class DeadCodeNode : public ASTNode {
+ public:
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kDeadCode;
+  }
+
+  DeadCodeNode(ASTNode *value, ASTNode *dead)
+      : ASTNode(NodeKind::kDeadCode), value_(value), dead_(dead) {}
+
+  llvm::Value *codegen(Context &context) override;
+  void mark_tail_position() override { value_->mark_tail_position(); }
+  ASTNode *value() const { return value_; }
+
+ private:
+  ASTNode *value_;
+  ASTNode *dead_;
+};
+
+// `&&` and `||` on conditions only evaluate their right-hand side when the
+// left-hand side does not already decide the result.
 class BinaryExprNode : public ASTNode {
  public:
   BinaryExprNode(Operator op, ASTNode *lhs, ASTNode *rhs)
-      : op_(op), lhs_(lhs), rhs_(rhs) {}
+      : ASTNode(NodeKind::kBinaryExpr), op_(op), lhs_(lhs), rhs_(rhs) {}
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
 
  private:
+  // Branches around the right-hand side on the i1 value of the left-hand
+  // side and merges the result in a PHI.
+  llvm::Value *CreateShortCircuit(Context &context, llvm::Value *lhs);
+
   Operator op_;
-  std::unique_ptr<ASTNode> lhs_;
-  std::unique_ptr<ASTNode> rhs_;
+  ASTNode *lhs_;
+  ASTNode *rhs_;
 };
 
 class TypeNode {
@@ -113,51 +254,100 @@ class TypeNode {
   Type type_;
 };
 
+// An annotation in front of a function, parameter or statement, e.g.
+// `@unroll(4)`.
+struct Attribute {
+  std::string name;
+  std::optional<int32_t> argument;
+};
+
+using AttributeList = std::vector<Attribute>;
+
+// Attributes in front of a pointer parameter tell the optimizer what the
+// caller guarantees about it:
+//   @noalias: no other pointer that the function uses reaches the same memory
+//   @nonnull: it is never null
+//   @dereferenceable(N): at least N elements can be read through it
 class ParameterNode {
  public:
-  ParameterNode(TypeNode *type, const char *name);
+  ParameterNode(TypeNode *type, Identifier name);
 
   llvm::Type *llvm_type(Context &context) { return type_->llvm_type(context); }
-  std::string name() { return name_; }
+  Type type() { return type_->get(); }
+  Identifier name() { return name_; }
+
+  void set_attributes(const AttributeList *attributes) {
+    attributes_ = attributes;
+  }
+  void apply_attributes(Context &context, llvm::Argument &arg);
 
  private:
-  std::unique_ptr<TypeNode> type_;
-  std::string name_;
+  TypeNode *type_;
+  Identifier name_;
+  const AttributeList *attributes_ = nullptr;
 };
 
 class ParameterListNode {
  public:
   ParameterListNode() = default;
 
-  std::vector<std::unique_ptr<ParameterNode>> &nodes() { return nodes_; }
+  std::vector<ParameterNode *> &nodes() { return nodes_; }
   void push_back(ParameterNode *node) { nodes_.emplace_back(node); }
 
  private:
-  std::vector<std::unique_ptr<ParameterNode>> nodes_;
+  std::vector<ParameterNode *> nodes_;
 };
 
+// Attributes in front of a function become LLVM function attributes:
+//   @inline, @noinline: always or never inline calls to it
+//   @pure: it only computes its result from its arguments, without reading
+//     or writing memory
+//   @readonly: like @pure, but it may read memory
+//   @cold: it is rarely called, so the paths that call it are treated as
+//     unlikely and laid out out of the way
+// Neither @pure nor @readonly is checked, and calls to such functions whose
+// result is unused may be removed.
 class FunctionDeclNode : public ASTNode {
  public:
-  FunctionDeclNode(const char *identifier, ParameterListNode *params,
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kFunctionDecl;
+  }
+
+  FunctionDeclNode(std::string_view identifier, ParameterListNode *params,
                    TypeNode *return_type);
 
   llvm::Value *codegen(Context &context) override;
+  const std::string &identifier() { return identifier_; }
+  ParameterListNode *params() { return params_; }
+  void set_attributes(const AttributeList *attributes) {
+    attributes_ = attributes;
+  }
 
  private:
+  void ApplyAttributes(llvm::Function *func);
+
   std::string identifier_;
-  std::unique_ptr<ParameterListNode> params_;
-  std::unique_ptr<TypeNode> return_type_;
+  ParameterListNode *params_;
+  TypeNode *return_type_;
+  const AttributeList *attributes_ = nullptr;
 };
 
 class ASTListNode : public ASTAggregateNode {
  public:
-  ASTListNode() = default;
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kASTList;
+  }
+
+  ASTListNode() : ASTAggregateNode(NodeKind::kASTList) {}
 
   void push_back(ASTNode *node) override { nodes_.emplace_back(node); }
+  const std::vector<ASTNode *> &nodes() const { return nodes_; }
   std::vector<llvm::Value *> codegen_aggregate(Context &context) override;
+  ASTNode *fold(AST &ast) override;
+  void mark_tail_position() override;
 
  private:
-  std::vector<std::unique_ptr<ASTNode>> nodes_;
+  std::vector<ASTNode *> nodes_;
 };
 
 class FunctionDefNode : public ASTNode {
@@ -165,21 +355,29 @@ class FunctionDefNode : public ASTNode {
   FunctionDefNode(ASTNode *decl, ASTNode *body);
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
 
  private:
-  std::unique_ptr<FunctionDeclNode> decl_;
-  std::unique_ptr<ASTNode> body_;
+  FunctionDeclNode *decl_;
+  ASTNode *body_;
 };
 
 class FunctionCallNode : public ASTNode {
  public:
-  FunctionCallNode(const char *identifier, ASTAggregateNode *params);
+  FunctionCallNode(std::string_view identifier, ASTAggregateNode *params);
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
+  void mark_tail_position() override { is_tail_call_ = true; }
 
  private:
+  // Returns `len(x)` of a variable `x` from its type, without loading an
+  // array, or nullptr if the call is anything else.
+  llvm::Value *CreateVariableLength(Context &context);
+
   std::string identifier_;
-  std::unique_ptr<ASTAggregateNode> params_;
+  ASTAggregateNode *params_;
+  bool is_tail_call_ = false;
 };
 
 class CastOpNode : public ASTNode {
@@ -187,10 +385,11 @@ class CastOpNode : public ASTNode {
   CastOpNode(TypeNode *type, ASTNode *value);
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
 
  private:
-  std::unique_ptr<TypeNode> type_;
-  std::unique_ptr<ASTNode> value_;
+  TypeNode *type_;
+  ASTNode *value_;
 };
 
 class BlockNode : public ASTNode {
@@ -198,22 +397,53 @@ class BlockNode : public ASTNode {
   explicit BlockNode(ASTAggregateNode *body, bool is_void = false);
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
+  void mark_tail_position() override { body_->mark_tail_position(); }
 
  private:
-  std::unique_ptr<ASTAggregateNode> body_;
+  ASTAggregateNode *body_;
   bool is_void_;
 };
 
 class VariableDeclarationNode : public ASTNode {
  public:
-  VariableDeclarationNode(TypeNode *type, const char *name, ASTNode *value);
+  VariableDeclarationNode(TypeNode *type, Identifier name, ASTNode *value);
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
 
  private:
-  std::unique_ptr<TypeNode> type_;
-  std::string name_;
-  std::unique_ptr<ASTNode> value_;
+  TypeNode *type_;
+  Identifier name_;
+  ASTNode *value_;
+};
+
+// A variable at module level, e.g. `i32 calls = 0;` or
+// `const i32[4] table = {1, 2, 4, 8};`, which every function after it can
+// use. Globals are initialized with literals before the program starts, or
+// zeroed if they have no initializer. Constants are placed in read-only data
+// and cannot be assigned to; writing to one through a pointer or slice is
+// undefined.
+class GlobalVariableNode : public ASTNode {
+ public:
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kGlobalVariable;
+  }
+
+  GlobalVariableNode(TypeNode *type, Identifier name,
+                     ASTAggregateNode *values);
+
+  llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
+  void set_constant() { is_constant_ = true; }
+
+ private:
+  llvm::Constant *Initializer(Context &context, llvm::Type *type);
+
+  TypeNode *type_;
+  Identifier name_;
+  ASTListNode *values_;
+  bool is_constant_ = false;
 };
 
 class AssignmentNode : public ASTNode {
@@ -221,10 +451,11 @@ class AssignmentNode : public ASTNode {
   AssignmentNode(AssignableNode *destination, ASTNode *value);
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
 
  private:
-  std::unique_ptr<AssignableNode> destination_;
-  std::unique_ptr<ASTNode> value_;
+  AssignableNode *destination_;
+  ASTNode *value_;
 };
 
 class MultiAssignmentNode : public ASTNode {
@@ -232,34 +463,40 @@ class MultiAssignmentNode : public ASTNode {
   MultiAssignmentNode(AssignableNode *destination, ASTAggregateNode *values);
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
 
  private:
-  std::unique_ptr<MultiAssignableNode> destination_;
-  std::unique_ptr<ASTAggregateNode> values_;
+  MultiAssignableNode *destination_;
+  ASTAggregateNode *values_;
 };
 
 class VariableNode : public MultiAssignableNode {
  public:
-  explicit VariableNode(const char *name);
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kVariable;
+  }
+
+  explicit VariableNode(Identifier name);
 
   llvm::Value *codegen(Context &context) override;
   llvm::Value *assign(Context &context, llvm::Value *value) override;
   llvm::Value *llvm_alloca(Context &context) override;
   Type type(Context &context) override;
+  bool is_constant(Context &context) override;
   llvm::Value *multi_assign(Context &context,
                             std::vector<llvm::Value *> values) override;
 
  private:
-  std::string name_;
+  Identifier name_;
 };
 
-class VariableListNode : public MultiAssignableNode, public ASTAggregateNode {
+class VariableListNode : public MultiAssignableNode {
  public:
-  VariableListNode() = default;
+  VariableListNode() : MultiAssignableNode(NodeKind::kVariableList) {}
 
-  void push_back(ASTNode *node) override;
+  void push_back(AssignableNode *node) { nodes_.push_back(node); }
   llvm::Value *codegen(Context &context) override;
-  std::vector<llvm::Value *> codegen_aggregate(Context &context) override;
+  ASTNode *fold(AST &ast) override;
   llvm::Value *assign(Context &context, llvm::Value *value) override;
   llvm::Value *llvm_alloca(Context &context) override;
   Type type(Context &context) override;
@@ -267,7 +504,7 @@ class VariableListNode : public MultiAssignableNode, public ASTAggregateNode {
                             std::vector<llvm::Value *> values) override;
 
  private:
-  std::vector<std::unique_ptr<AssignableNode>> nodes_;
+  std::vector<AssignableNode *> nodes_;
 };
 
 class CondExprNode : public ASTNode {
@@ -275,11 +512,13 @@ class CondExprNode : public ASTNode {
   CondExprNode(ASTNode *cond, ASTNode *then, ASTNode *els);
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
+  void mark_tail_position() override;
 
  private:
-  std::unique_ptr<ASTNode> cond_;
-  std::unique_ptr<ASTNode> then_;
-  std::unique_ptr<ASTNode> else_;
+  ASTNode *cond_;
+  ASTNode *then_;
+  ASTNode *else_;
 };
 
 class CondStatementNode : public ASTNode {
@@ -287,59 +526,219 @@ class CondStatementNode : public ASTNode {
   CondStatementNode(ASTNode *cond, ASTNode *then, ASTNode *els);
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
+  void mark_tail_position() override;
+
+ private:
+  ASTNode *cond_;
+  ASTNode *then_;
+  ASTNode *else_;
+};
+
+// Loops are lowered to the canonical form the LLVM loop passes expect: the
+// block before the loop is its preheader, the condition is checked in the
+// header and the body ends in a single latch that branches back to it.
+// Attributes in front of the loop become `llvm.loop` hints on the latch:
+//   @unroll, @unroll(N), @nounroll
+//   @vectorize, @vectorize(N), @novectorize
+//   @interleave(N)
+class LoopNode : public ASTNode {
+ public:
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kWhileLoop ||
+           node->kind() == NodeKind::kForLoop;
+  }
+
+  void set_attributes(const AttributeList *attributes) {
+    attributes_ = attributes;
+  }
+
+ protected:
+  using ASTNode::ASTNode;
+
+  // Branches from the current block, the latch, back to `header`.
+  void CreateLatch(Context &context, llvm::BasicBlock *header);
+
+ private:
+  llvm::MDNode *LoopMetadata(Context &context);
+
+  const AttributeList *attributes_ = nullptr;
+};
+
+// `while cond do { ... }`
+class WhileLoopNode : public LoopNode {
+ public:
+  WhileLoopNode(ASTNode *cond, ASTNode *body);
+
+  llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
+
+ private:
+  ASTNode *cond_;
+  ASTNode *body_;
+};
+
+// `for i in begin..end do { ... }` runs the body for every i32 from `begin`
+// up to, but not including, `end`. Both bounds are evaluated once, before
+// the loop, and `i` is constant inside the body.
+class ForLoopNode : public LoopNode {
+ public:
+  ForLoopNode(Identifier variable, ASTNode *begin, ASTNode *end,
+              ASTNode *body);
+
+  llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
 
  private:
-  std::unique_ptr<ASTNode> cond_;
-  std::unique_ptr<ASTNode> then_;
-  std::unique_ptr<ASTNode> else_;
+  Identifier variable_;
+  ASTNode *begin_;
+  ASTNode *end_;
+  ASTNode *body_;
 };
 
+// The elements of an array of a @soa struct have no address, since their
+// fields are spread over one array per field. Reading one gathers its
+// fields, and assigning to one scatters them.
 class ArrayAccessNode : public AssignableNode {
  public:
-  ArrayAccessNode(const char *name, ASTNode *index);
+  static bool classof(const ASTNode *node) {
+    return node->kind() == NodeKind::kArrayAccess;
+  }
+
+  ArrayAccessNode(Identifier name, ASTNode *index);
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
   llvm::Value *llvm_alloca(Context &context) override;
   Type type(Context &context) override;
   llvm::Value *assign(Context &context, llvm::Value *value) override;
+  bool is_constant(Context &context) override;
+
+  // Whether the array is a structure of arrays.
+  bool is_soa_element(Context &context);
+  // Returns the address of the field with index `field` of the element of a
+  // structure of arrays.
+  llvm::Value *soa_field_pointer(Context &context, unsigned field);
 
  private:
-  std::string name_;
-  std::unique_ptr<ASTNode> index_;
+  // The type of the elements of the array or slice.
+  llvm::Type *ElementType(Context &context);
+  // Evaluates the index and checks it against the bounds of the array or
+  // slice.
+  llvm::Value *CreateIndex(Context &context);
+  llvm::Value *CreateElementPointer(Context &context);
+  llvm::Value *CreateFieldPointer(Context &context, llvm::Value *index,
+                                  unsigned field);
+
+  Identifier name_;
+  ASTNode *index_;
+};
+
+// `base.field` is a field of a struct. Pointers to structs are dereferenced
+// first, so `p.x` also works for a `struct Point& p`. On an array of a @soa
+// struct, `points.x` is the whole array of the field.
+class FieldAccessNode : public AssignableNode {
+ public:
+  FieldAccessNode(AssignableNode *base, Identifier field);
+
+  llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
+  llvm::Value *llvm_alloca(Context &context) override;
+  Type type(Context &context) override;
+  llvm::Value *assign(Context &context, llvm::Value *value) override;
+  bool is_constant(Context &context) override;
+
+ private:
+  // Returns the struct that the field belongs to. Throws std::runtime_error
+  // if the base is not a struct, a pointer to one or a structure of arrays.
+  const StructInfo *BaseStruct(const Type &base_type);
+
+  AssignableNode *base_;
+  Identifier field_;
+};
+
+// `name[begin..end]` is the slice of the elements of an array or slice from
+// `begin` up to, but not including, `end`. It points into `name`, nothing is
+// copied.
+class SliceNode : public ASTNode {
+ public:
+  SliceNode(Identifier name, ASTNode *begin, ASTNode *end);
+
+  llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
+
+ private:
+  Identifier name_;
+  ASTNode *begin_;
+  ASTNode *end_;
 };
 
 class GetAddressNode : public ASTNode {
  public:
-  explicit GetAddressNode(ASTNode *node);
+  explicit GetAddressNode(AssignableNode *node);
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
 
  private:
-  std::unique_ptr<ASTNode> node_;
+  AssignableNode *node_;
 };
 
 class DereferenceNode : public AssignableNode {
  public:
-  explicit DereferenceNode(ASTNode *node);
+  explicit DereferenceNode(AssignableNode *node);
 
   llvm::Value *codegen(Context &context) override;
+  ASTNode *fold(AST &ast) override;
   llvm::Value *llvm_alloca(Context &context) override;
   Type type(Context &context) override;
   llvm::Value *assign(Context &context, llvm::Value *value) override;
 
  private:
-  std::unique_ptr<ASTNode> node_;
+  AssignableNode *node_;
 };
 
 class AST {
  public:
-  explicit AST(ASTAggregateNode *root);
+  // Creates a node, or any other object, that lives as long as the AST.
+  template <typename T, typename... Args>
+  T *New(Args &&...args) {
+    return arena_.New<T>(std::forward<Args>(args)...);
+  }
+
+  // Returns the identifier for `name`, which gets the next free SymbolId the
+  // first time it is seen.
+  Identifier Intern(std::string_view name);
 
+  void set_root(ASTAggregateNode *root) { root_ = root; }
+
+  // Declares the struct `name` when its definition starts, so that its
+  // fields can point to it, and applies the attributes of its layout.
+  // Throws std::runtime_error if there already is a struct of that name.
+  StructInfo *DeclareStruct(std::string_view name,
+                            const AttributeList *attributes);
+  // Completes the definition of `info` with its fields.
+  void DefineStruct(StructInfo *info, FieldList *fields);
+  // Returns the struct `name`. Throws std::runtime_error if there is none.
+  const StructInfo *GetStruct(std::string_view name);
+
+  // Folds constants, see ASTNode::fold, and generates the module.
   void codegen();
+  // Prints the struct types, globals, functions, attribute groups and
+  // metadata of the module, in definition order. Intrinsics are declared
+  // without attributes, since those differ between LLVM versions.
+  void print(llvm::raw_ostream &out);
+
+  Context &context() { return llvm_context; }
 
  private:
   Context llvm_context;
-  std::unique_ptr<ASTAggregateNode> root_;
+  Arena arena_;
+  std::unordered_map<std::string_view, SymbolId> symbol_ids_;
+  // The structs in definition order, and by the id of their name.
+  std::vector<StructInfo *> structs_;
+  std::unordered_map<SymbolId, StructInfo *> struct_ids_;
+  ASTAggregateNode *root_ = nullptr;
 };
 
 }  // namespace chovl
\ No newline at end of file
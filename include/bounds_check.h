@@ -0,0 +1,42 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Module.h>
+
+namespace chovl {
+
+// Counts the bounds checks of -fbounds-check in one module.
+struct BoundsCheckStats {
+  // Checks that were emitted.
+  unsigned emitted = 0;
+  // Checks that were left out because the index is a constant in range.
+  unsigned elided = 0;
+  // Checks that are still there after optimization.
+  unsigned remaining = 0;
+
+  BoundsCheckStats &operator+=(const BoundsCheckStats &other) {
+    emitted += other.emitted;
+    elided += other.elided;
+    remaining += other.remaining;
+    return *this;
+  }
+};
+
+// Checks that `index` is below `length`, or at most `length` if `inclusive`
+// is set, and continues in a new block if it is. Otherwise the check
+// branches to `trap_block`, which is created on first use and must then be
+// added to the end of the function by the caller. A single unsigned
+// comparison also catches negative indices, and the branch is marked as
+// taken through llvm.expect, so the trap is laid out as cold code.
+//
+// A check that folds to a constant is not emitted. Throws
+// std::runtime_error for a constant index that is out of bounds.
+void CreateBoundsCheck(llvm::IRBuilder<> &builder, llvm::Value *index,
+                       llvm::Value *length, bool inclusive,
+                       llvm::BasicBlock *&trap_block, BoundsCheckStats &stats);
+
+// Returns the number of bounds checks in `module`, i.e. the number of
+// branches into trap blocks.
+unsigned CountBoundsChecks(const llvm::Module &module);
+
+}  // namespace chovl
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Value.h>
+
+#include <string_view>
+#include <vector>
+
+namespace chovl {
+
+// Emits a call to a builtin function on SIMD vectors or slices. Functions of
+// the program take precedence, so this is only tried for names that are not
+// declared. Returns nullptr if there is no builtin called `name`.
+//
+//   len(s)                 the number of elements of a slice or array
+//   extract(v, lane)       the value of a lane
+//   insert(v, lane, x)     v with the lane replaced by x
+//   reduce_add(v)          the sum of all lanes
+//   reduce_mul(v)          the product of all lanes
+//   reduce_min(v)          the smallest lane
+//   reduce_max(v)          the largest lane
+//
+// Splatting a scalar to all lanes is a cast, e.g. `x as f32x4`.
+llvm::Value *CreateBuiltinCall(llvm::IRBuilder<> *builder,
+                               std::string_view name,
+                               const std::vector<llvm::Value *> &args);
+
+}  // namespace chovl
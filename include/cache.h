@@ -0,0 +1,29 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <memory>
+#include <string>
+
+#include "optimizer.h"
+
+namespace chovl {
+
+// Optimizes the module one function at a time, reusing the results of
+// previous compilations that were stored in `cache_dir`.
+//
+// Every function definition is split into its own module together with the
+// declarations it references. The bitcode of that module and the
+// optimization level form the cache key, so an entry is only reused if neither
+// the function nor any prototype or global it depends on has changed. Because
+// functions are optimized in isolation, calls between functions of the same
+// file are not inlined in this mode.
+//
+// Returns the optimized module, which lives in the same LLVMContext.
+std::unique_ptr<llvm::Module> OptimizeModuleCached(
+    std::unique_ptr<llvm::Module> module, OptimizationLevel level,
+    llvm::TargetMachine *target_machine, const std::string &cache_dir,
+    TimeReport *time_report = nullptr);
+
+}  // namespace chovl
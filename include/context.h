@@ -6,20 +6,40 @@
 
 #include <memory>
 #include <unordered_map>
+#include <vector>
+
+#include "bounds_check.h"
+#include "tail_calls.h"
 
 namespace chovl {
 
 // TODO: Think about a design where we do not have to add this forward
 // declaration.
 class SymbolTable;
+class TimeReport;
 
 struct Context {
   Context();
   ~Context() = default;
 
-  llvm::LLVMContext llvm_context;
+  // Owned through a pointer so that the context and module can be handed off
+  // together, e.g. to the JIT.
+  std::unique_ptr<llvm::LLVMContext> llvm_context;
   std::unique_ptr<llvm::IRBuilder<>> llvm_builder;
   std::unique_ptr<llvm::Module> llvm_module;
   std::unique_ptr<SymbolTable> symbol_table;
+  // Set for -ftime-report.
+  TimeReport *time_report = nullptr;
+  TailCallMode tail_call_mode = TailCallMode::kAuto;
+  // The calls in tail position of the function that is being generated.
+  std::vector<llvm::CallInst *> tail_calls;
+  // Set for -fbounds-check.
+  bool bounds_check = false;
+  BoundsCheckStats bounds_check_stats;
+  // The block that failed bounds checks of the current function branch to.
+  llvm::BasicBlock *bounds_trap = nullptr;
+  // The private globals that constant arrays and string literals are stored
+  // in, so that every distinct one is only emitted once per module.
+  std::unordered_map<llvm::Constant *, llvm::GlobalVariable *> constant_data;
 };
 }  // namespace chovl
\ No newline at end of file
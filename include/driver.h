@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "frontend.h"
+#include "optimizer.h"
+#include "tail_calls.h"
+#include "target.h"
+
+namespace chovl {
+
+enum class OutputKind : uint8_t { kIR, kBitcode, kAssembly, kObject };
+
+struct DriverOptions {
+  std::vector<std::string> input_files;
+  std::string output_file;
+  OptimizationLevel opt_level = OptimizationLevel::kO0;
+  OutputKind output_kind = OutputKind::kIR;
+  LexerKind lexer = LexerKind::kFlex;
+  TailCallMode tail_calls = TailCallMode::kAuto;
+  TargetConfig target;
+  // Checks every array and slice access, and traps if it is out of bounds.
+  bool bounds_check = false;
+  // Prints how many bounds checks were elided or optimized away to stderr.
+  bool bounds_check_report = false;
+  // Instruments the program for a profile, or optimizes it with one.
+  ProfileConfig profile;
+  // Optimizes the linked program as a whole, after making everything but
+  // `main` and `exports` internal to it.
+  bool lto = false;
+  std::vector<std::string> exports;
+  bool run = false;
+  unsigned jobs = 1;
+  // When set, optimized functions are cached here between compilations.
+  // Ignored with --lto and when a profile is generated or used.
+  std::string cache_dir;
+  // Prints the time spent in every phase to stderr.
+  bool time_report = false;
+  // When set, a Chrome trace of the compilation is written here.
+  std::string time_trace_file;
+  // Events shorter than this many microseconds are left out of the trace.
+  unsigned time_trace_granularity = 500;
+};
+
+// Parses the command line of the chovl executable. Throws std::runtime_error
+// on invalid arguments.
+DriverOptions ParseArguments(int argc, char **argv);
+
+// Compiles every input file on its own worker thread, links the results into
+// a single module and then either writes it out or runs it. Returns the exit
+// code of the process.
+int RunDriver(const DriverOptions &options);
+
+}  // namespace chovl
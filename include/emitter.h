@@ -0,0 +1,22 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/Support/CodeGen.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <string>
+
+namespace chovl {
+
+// Streams the textual IR of the whole module to `path`.
+void EmitIRFile(const llvm::Module &module, const std::string &path);
+
+// Writes the module to `path` in the LLVM bitcode format.
+void EmitBitcodeFile(const llvm::Module &module, const std::string &path);
+
+// Runs the target's code generator over the module and writes the result to
+// `path`, either as native assembly or as an object file.
+void EmitNativeFile(llvm::Module &module, llvm::TargetMachine &target_machine,
+                    const std::string &path, llvm::CodeGenFileType file_type);
+
+}  // namespace chovl
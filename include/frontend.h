@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "ast.h"
+
+namespace chovl {
+
+// kFast selects the hand-written lexer in fast_lexer.h.
+enum class LexerKind : uint8_t { kFlex, kFast };
+
+// Parses a whole ChovL source file. Every call uses its own scanner and parser
+// state, so independent sources can be parsed concurrently. Throws
+// std::runtime_error on syntax errors.
+std::unique_ptr<AST> Parse(std::string_view source,
+                           LexerKind lexer = LexerKind::kFlex);
+
+// Runs only the lexer over `source` and returns the number of tokens in it.
+size_t Tokenize(std::string_view source, LexerKind lexer = LexerKind::kFlex);
+
+}  // namespace chovl
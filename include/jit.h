@@ -0,0 +1,16 @@
+#pragma once
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+#include <memory>
+
+namespace chovl {
+
+// Compiles the module in-process with an ORC LLJIT instance and calls its
+// `main` function, returning the value it returns. Undefined symbols, such as
+// `putchar` or `puts`, are resolved against the host process.
+int RunModule(std::unique_ptr<llvm::Module> module,
+              std::unique_ptr<llvm::LLVMContext> llvm_context);
+
+}  // namespace chovl
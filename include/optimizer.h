@@ -0,0 +1,63 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "timing.h"
+
+namespace chovl {
+
+enum class OptimizationLevel : uint8_t { kO0, kO1, kO2, kO3, kOs };
+
+// Profile-guided optimization. A program is first compiled with
+// instrumentation and run on representative inputs, which writes a raw
+// profile. After `llvm-profdata merge` has turned the raw profiles into an
+// indexed one, the program is compiled again using it, which gives the
+// optimizer real branch weights and call counts to base inlining and block
+// layout on.
+struct ProfileConfig {
+  // When set, every function counts how often its edges run, and the program
+  // writes the counts to this .profraw file when it exits. The program has
+  // to be linked with the chovl_profile runtime.
+  std::string generate_file;
+  // When set, the indexed .profdata file to optimize with.
+  std::string use_file;
+
+  bool enabled() const { return !generate_file.empty() || !use_file.empty(); }
+};
+
+// Runs the LLVM default pipeline for the given level over the whole module.
+// kO0 only runs the passes that are required for correctness, such as the
+// always-inliner. When a target machine is given, its cost model is used by
+// target-dependent passes such as the vectorizers. Every pass is timed in
+// `time_report` if it is given, and in the time trace if that is enabled.
+// Instrumentation for a profile is added even at kO0, while a profile is only
+// used by the optimizing levels.
+void OptimizeModule(llvm::Module &module, OptimizationLevel level,
+                    llvm::TargetMachine *target_machine = nullptr,
+                    TimeReport *time_report = nullptr,
+                    const ProfileConfig &profile = {});
+
+// Link-time optimization. Every unit is optimized on its own with the
+// pre-link pipeline, which leaves out the passes that pay off more once the
+// whole program is known, such as most inlining and the vectorizers.
+void OptimizeModuleForLTO(llvm::Module &module, OptimizationLevel level,
+                          llvm::TargetMachine *target_machine = nullptr,
+                          TimeReport *time_report = nullptr,
+                          const ProfileConfig &profile = {});
+
+// Optimizes the program that the units were linked into. Every definition
+// except `main` and `exports` is made internal, and internal functions use
+// the fast calling convention, so the full pipeline is free to inline across
+// the former units, change signatures and delete whatever is left unused.
+void OptimizeProgram(llvm::Module &module, OptimizationLevel level,
+                     llvm::TargetMachine *target_machine,
+                     const std::vector<std::string> &exports,
+                     TimeReport *time_report = nullptr,
+                     const ProfileConfig &profile = {});
+
+}  // namespace chovl
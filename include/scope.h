@@ -1,19 +1,40 @@
 #pragma once
 
+#include <llvm/IR/DerivedTypes.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Value.h>
 
-#include <string>
-#include <unordered_map>
+#include <cstdint>
+#include <deque>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "context.h"
 
 namespace chovl {
 
-enum class AggregateType : uint8_t { kSingular, kArray };
+// A slice, written `T[]`, refers to a run of elements that lives elsewhere.
+// It is passed around as a pointer to the first element and an i32 length,
+// so arrays can be handed to functions without copying them.
+enum class AggregateType : uint8_t { kSingular, kArray, kSlice };
 enum class IndirectionType : uint8_t { kNone, kPointer };
-enum class PrimitiveType : uint8_t { kNone, kI32, kF32, kChar };
+// The vector types are SIMD vectors of a fixed number of lanes, e.g. kF32x4
+// holds four f32s. Arithmetic on them works lane by lane. kStruct is any
+// struct type; which one is given by the StructInfo of the Type.
+enum class PrimitiveType : uint8_t {
+  kNone,
+  kI32,
+  kF32,
+  kChar,
+  kF32x4,
+  kF32x8,
+  kI32x4,
+  kI32x8,
+  kStruct,
+};
+
+class StructInfo;
 
 struct Type {
   Type(PrimitiveType kind, IndirectionType indirection)
@@ -26,24 +47,62 @@ struct Type {
         aggregate_kind_(AggregateType::kArray),
         size_(size),
         indirection_(indirection) {}
+  Type(const StructInfo *info, IndirectionType indirection)
+      : Type(PrimitiveType::kStruct, indirection) {
+    struct_info_ = info;
+  }
+  Type(const StructInfo *info, size_t size, IndirectionType indirection)
+      : Type(PrimitiveType::kStruct, size, indirection) {
+    struct_info_ = info;
+  }
 
   explicit Type(llvm::Type *type);
 
+  static Type Slice(PrimitiveType kind);
+  static Type Slice(const StructInfo *info);
+
   llvm::Type *llvm_type(Context &context) const;
   PrimitiveType kind() const { return kind_; }
+  AggregateType aggregate_kind() const { return aggregate_kind_; }
   IndirectionType indirection() const { return indirection_; }
+  // The number of elements of an array.
+  size_t size() const { return size_; }
+  // The struct of kStruct types, nullptr otherwise.
+  const StructInfo *struct_info() const { return struct_info_; }
+  // The type of a single element, e.g. `i32` for `i32[4]`, `i32[]` and
+  // `i32&`.
+  Type element() const;
+  // Whether this is an array of a @soa struct.
+  bool is_soa() const;
+  // The alignment in bytes that variables of the type need beyond the ABI
+  // alignment of their LLVM type, or 0 if there is none.
+  uint32_t alignment() const;
 
  private:
+  // The LLVM type of a single element.
+  llvm::Type *ElementLLVMType(Context &context) const;
+
   PrimitiveType kind_;
   AggregateType aggregate_kind_;
   IndirectionType indirection_;
   size_t size_;
+  const StructInfo *struct_info_ = nullptr;
 };
 
+// The LLVM type of every slice, `{ ptr, i32 }`. Literal struct types are
+// unique, so slice values can be recognized by comparing their type to it.
+llvm::StructType *GetSliceType(llvm::LLVMContext &context);
+
+// A variable in scope. Its memory is an alloca for locals and parameters,
+// and a global variable for globals.
 class SymbolicValue {
  public:
-  SymbolicValue(llvm::Value *value, llvm::AllocaInst *alloca, Type type)
-      : value_(value), alloca_(alloca), type_(type) {}
+  SymbolicValue(llvm::Value *value, llvm::Value *alloca, Type type,
+                bool is_constant = false)
+      : value_(value),
+        alloca_(alloca),
+        type_(type),
+        is_constant_(is_constant) {}
 
   SymbolicValue(const SymbolicValue &) = delete;
   SymbolicValue &operator=(const SymbolicValue &) = delete;
@@ -52,27 +111,106 @@ class SymbolicValue {
   SymbolicValue &operator=(SymbolicValue &&) noexcept;
 
   llvm::Value *llvm_value() const { return value_; }
-  llvm::AllocaInst *llvm_alloca() const { return alloca_; }
+  llvm::Value *llvm_alloca() const { return alloca_; }
   llvm::Type *llvm_type(Context &context) const {
     return type_.llvm_type(context);
   }
   Type type() const { return type_; }
+  // Constants cannot be assigned to.
+  bool is_constant() const { return is_constant_; }
 
  private:
   llvm::Value *value_;
-  llvm::AllocaInst *alloca_;
+  llvm::Value *alloca_;
   Type type_;
+  bool is_constant_;
+};
+
+// Identifiers are interned by the parser, so equal names share a SymbolId and
+// ids are dense enough to index arrays with.
+using SymbolId = uint32_t;
+
+struct Identifier {
+  SymbolId id;
+  std::string_view name;
+};
+
+struct Field {
+  Identifier name;
+  Type type;
+};
+
+using FieldList = std::vector<Field>;
+
+// A struct type, `struct Name { T field; ... }`, which is lowered to the
+// named LLVM struct type `%struct.Name`. Attributes in front of the
+// definition control its layout:
+//   @packed: the fields are not padded to their alignment
+//   @align(N): variables of the type are aligned to N bytes, and its size is
+//     padded to a multiple of N, so that every element of an array is
+//     aligned too
+//   @soa: arrays of the type are stored as a structure of arrays, i.e. one
+//     array per field, so that a loop over some of the fields only reads
+//     the memory of those
+class StructInfo {
+ public:
+  explicit StructInfo(Identifier name) : name_(name) {}
+
+  Identifier name() const { return name_; }
+  const FieldList &fields() const { return fields_; }
+  // Returns the index of the field `name`. Throws std::runtime_error if the
+  // struct has none.
+  unsigned field_index(Identifier name) const;
+  bool is_packed() const { return is_packed_; }
+  uint32_t alignment() const { return alignment_; }
+  bool is_soa() const { return is_soa_; }
+
+  void set_fields(FieldList fields) { fields_ = std::move(fields); }
+  void set_packed() { is_packed_ = true; }
+  void set_alignment(uint32_t alignment) { alignment_ = alignment; }
+  void set_soa() { is_soa_ = true; }
+
+  // Returns `%struct.Name`, which is created on first use.
+  llvm::StructType *llvm_type(Context &context) const;
+  // Returns the structure of arrays of `size` elements, a literal struct of
+  // one `[size x T]` array for every field T.
+  llvm::StructType *soa_type(Context &context, size_t size) const;
+
+ private:
+  Identifier name_;
+  FieldList fields_;
+  bool is_packed_ = false;
+  uint32_t alignment_ = 0;
+  bool is_soa_ = false;
 };
 
+// Scopes are a single stack of bindings. Every id points directly at its
+// innermost binding, and every binding remembers the one it shadows, so
+// lookups are an array load and leaving a scope pops back to the scope's
+// watermark.
 class SymbolTable {
  public:
-  void AddSymbol(const std::string &name, SymbolicValue value);
-  SymbolicValue &GetSymbol(const std::string &name);
-  const SymbolicValue &GetSymbol(const std::string &name) const;
+  void AddSymbol(SymbolId id, SymbolicValue value);
+  SymbolicValue &GetSymbol(SymbolId id);
+  const SymbolicValue &GetSymbol(SymbolId id) const;
   void AddScope();
   void RemoveScope();
 
  private:
-  std::vector<std::unordered_map<std::string, SymbolicValue>> symbols_;
+  static constexpr uint32_t kUnbound = UINT32_MAX;
+
+  struct Binding {
+    SymbolId id;
+    uint32_t shadowed;
+    SymbolicValue value;
+  };
+
+  // A deque, so that references to values stay valid while nested code adds
+  // bindings.
+  std::deque<Binding> bindings_;
+  // Index into bindings_ of the innermost binding of every id, or kUnbound.
+  std::vector<uint32_t> innermost_;
+  // The size of bindings_ when each open scope was entered.
+  std::vector<size_t> scope_starts_;
 };
 }  // namespace chovl
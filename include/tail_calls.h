@@ -0,0 +1,36 @@
+#pragma once
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+
+#include <cstdint>
+
+namespace chovl {
+
+// How calls in tail position, i.e. calls whose value is returned by the
+// function, are emitted.
+enum class TailCallMode : uint8_t {
+  // As ordinary calls.
+  kNone,
+  // Marked `tail` when the callee cannot access the caller's stack frame,
+  // which lets the backend reuse the frame for the callee.
+  kAuto,
+  // In addition, self-recursive calls become branches back to the start of
+  // the function, even without optimizations, and calls to functions with
+  // the same prototype become `musttail` calls.
+  kGuaranteed,
+};
+
+// Rewrites the tail calls of `function` according to `mode`, once the whole
+// function has been generated. `calls` are the calls that were emitted for
+// FunctionCallNodes in tail position.
+//
+// No call is rewritten if an alloca of the function may escape, since the
+// callee could then access the caller's frame. A call that returns through
+// blocks that only merge values, as for an if expression, is moved right
+// before a return of its own first.
+void LowerTailCalls(llvm::Function &function,
+                    llvm::ArrayRef<llvm::CallInst *> calls, TailCallMode mode);
+
+}  // namespace chovl
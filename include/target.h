@@ -0,0 +1,47 @@
+#pragma once
+
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include <memory>
+#include <string>
+
+#include "optimizer.h"
+
+namespace chovl {
+
+// The processor that code is generated for, as selected by -march, -mcpu and
+// -mattr.
+struct TargetConfig {
+  // A processor name like "skylake", or "native" for the host processor.
+  std::string cpu = "generic";
+  // Comma separated features that are added to or removed from the ones of
+  // the processor, e.g. "+avx2,-fma".
+  std::string features;
+};
+
+// Registers the native target and its asm printer. Registration is not
+// thread-safe, so this has to be called once, before any thread creates a
+// target machine.
+void InitializeNativeTarget();
+
+// Creates a TargetMachine for the host triple and the configured processor.
+// The code generator optimization level follows the given IR optimization
+// level. InitializeNativeTarget must have been called. Throws
+// std::runtime_error for processors the target does not know.
+std::unique_ptr<llvm::TargetMachine> CreateTargetMachine(
+    OptimizationLevel level, const TargetConfig &config = {});
+
+// Sets the module's target triple and data layout to the ones of the target
+// machine. This should happen before code generation, so that everything that
+// depends on the data layout (e.g. alignments) is computed for the target.
+void ConfigureModule(llvm::Module &module,
+                     const llvm::TargetMachine &target_machine);
+
+// Adds the target-cpu and target-features attributes of the target machine to
+// every function defined in the module. The optimizer and the code generator
+// read the processor from these attributes, e.g. to pick the vector width.
+void SetTargetAttributes(llvm::Module &module,
+                         const llvm::TargetMachine &target_machine);
+
+}  // namespace chovl
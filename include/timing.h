@@ -0,0 +1,75 @@
+#pragma once
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class PassInstrumentationCallbacks;
+}  // namespace llvm
+
+namespace chovl {
+
+// Collects the time spent in every phase of the compiler for -ftime-report.
+// Phases nest, e.g. verifying a function happens while generating code for
+// it, and every phase is only charged the time that is not spent in a nested
+// one, so the times add up to the total. Phases can be timed on any thread.
+class TimeReport {
+ public:
+  // Times every optimization pass as a phase of its own.
+  void RegisterPassCallbacks(llvm::PassInstrumentationCallbacks &callbacks);
+
+  // Prints the phases and the slowest individual items, e.g. functions, that
+  // were timed.
+  void Print(llvm::raw_ostream &out) const;
+
+ private:
+  friend class PhaseScope;
+
+  struct Phase {
+    std::string name;
+    double seconds = 0;
+    unsigned count = 0;
+  };
+
+  struct Item {
+    std::string phase;
+    std::string detail;
+    double seconds;
+  };
+
+  void Begin(llvm::StringRef name);
+  // Ends the innermost phase of this thread. If `detail` is not empty, the
+  // whole time of the phase is also recorded as an item.
+  void End(llvm::StringRef detail = "");
+
+  mutable std::mutex mutex_;
+  std::vector<Phase> phases_;
+  std::vector<Item> items_;
+};
+
+// Times a phase for as long as it is in scope: in `report` for -ftime-report
+// unless it is null, and as an event of the LLVM time trace profiler for
+// -ftime-trace if that is enabled on this thread. `detail`, e.g. the name of
+// a function, tells events of the same phase apart.
+class PhaseScope {
+ public:
+  PhaseScope(TimeReport *report, llvm::StringRef name,
+             llvm::StringRef detail = "");
+  ~PhaseScope();
+
+  PhaseScope(const PhaseScope &) = delete;
+  PhaseScope &operator=(const PhaseScope &) = delete;
+
+ private:
+  TimeReport *report_;
+  std::string detail_;
+  llvm::TimeTraceScope trace_;
+};
+
+}  // namespace chovl
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace chovl {
+
+// The text of an identifier or string literal token. It points into the buffer
+// that is being scanned, which outlives the parse, so the lexer never has to
+// copy it. The parser's value union only takes trivial types, which rules out
+// std::string_view itself.
+struct TokenText {
+  const char *data;
+  uint32_t size;
+
+  operator std::string_view() const { return {data, size}; }
+};
+
+}  // namespace chovl
@@ -1,45 +1,28 @@
 #include <iostream>
-#include <vector>
 #include <stdexcept>
 
-#include "ast.h"
-#include "gen/parser.h"
-
-extern int yylex(void);
+#include "driver.h"
 
 int main(int argc, char **argv) {
   if (argc < 2) {
-    std::cerr << "Usage: " << argv[0] << " file [-o output_file]" << '\n';
-    return 1;
-  }
-  
-  const char *input_file = argv[1];
-  const char *output_file = [&]() -> const char* {
-    if (argc == 4) {
-      if (std::string(argv[2]) == "-o") {
-        return argv[3];
-      } else {
-        std::cout << "Invalid argument";
-        exit(1);
-      }
-    }
-    return "a.ll";
-  }();
-
-  if (freopen(input_file, "r", stdin) == nullptr) {
-    std::cerr << "Could not open input file: " << input_file << '\n';
-    return 1;
-  }
-  if (freopen(output_file, "w", stdout) == nullptr) {
-    std::cerr << "Could not open output file: " << output_file << '\n';
+    std::cerr << "Usage: " << argv[0]
+              << " file... [-o output_file] [-O0|-O1|-O2|-O3|-Os]"
+              << " [--emit=ll|bc|asm|obj] [-c|-S|--run] [-j jobs]"
+              << " [--cache-dir=dir] [--lto] [--export=name,...]"
+              << " [--lexer=flex|fast]"
+              << " [-ftail-calls=none|auto|guaranteed]"
+              << " [-march=cpu|native] [-mcpu=cpu] [-mattr=+feature,-feature]"
+              << " [-fbounds-check] [-fbounds-check-report]"
+              << " [-fprofile-generate[=dir]] [-fprofile-use=path]"
+              << " [-ftime-report] [-ftime-trace[=file]]"
+              << " [-ftime-trace-granularity=us]" << '\n';
     return 1;
   }
 
   try {
-    yyparse();
+    return chovl::RunDriver(chovl::ParseArguments(argc, argv));
   } catch (std::exception &e) {
     std::cerr << e.what() << '\n';
     return 1;
   }
-  return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,151 @@
+// A minimal replacement for compiler-rt's profile runtime, which programs
+// compiled with -fprofile-generate are linked with. When the program exits,
+// it writes the counters of the instrumented functions as a raw profile in
+// the format of LLVM 18, which llvm-profdata merges into an indexed profile.
+//
+// The instrumentation places its data in sections that the linker provides
+// start and stop symbols for, so nothing has to be registered at startup.
+// Value profiling is not supported, which only indirect calls and memory
+// intrinsics of variable size would need.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PROFILE_MAGIC 0xff6c70726f667281ULL
+#define PROFILE_RAW_VERSION 9
+#define PROFILE_VERSION_MASK 0xffffffffULL
+#define PROFILE_VALUE_KIND_LAST 1
+
+// Referenced from every instrumented module, so that linking with the
+// library is enough to pull this file in.
+int __llvm_profile_runtime;
+
+// Defined by the instrumented modules. The version also has bits set for the
+// kind of instrumentation, and the file name is only there if the program
+// was compiled with one.
+extern const uint64_t __llvm_profile_raw_version __attribute__((weak));
+extern const char __llvm_profile_filename[] __attribute__((weak));
+
+extern char __start___llvm_prf_data[] __attribute__((weak));
+extern char __stop___llvm_prf_data[] __attribute__((weak));
+extern char __start___llvm_prf_cnts[] __attribute__((weak));
+extern char __stop___llvm_prf_cnts[] __attribute__((weak));
+extern char __start___llvm_prf_bits[] __attribute__((weak));
+extern char __stop___llvm_prf_bits[] __attribute__((weak));
+extern char __start___llvm_prf_names[] __attribute__((weak));
+extern char __stop___llvm_prf_names[] __attribute__((weak));
+
+// The per-function record in __llvm_prf_data. Only its size is needed.
+struct ProfileData {
+  uint64_t name_ref;
+  uint64_t func_hash;
+  intptr_t counter_ptr;
+  intptr_t bitmap_ptr;
+  intptr_t function_pointer;
+  intptr_t values;
+  uint32_t num_counters;
+  uint16_t num_value_sites[PROFILE_VALUE_KIND_LAST + 1];
+  uint32_t num_bitmap_bytes;
+};
+
+struct ProfileHeader {
+  uint64_t magic;
+  uint64_t version;
+  uint64_t binary_ids_size;
+  uint64_t num_data;
+  uint64_t padding_bytes_before_counters;
+  uint64_t num_counters;
+  uint64_t padding_bytes_after_counters;
+  uint64_t num_bitmap_bytes;
+  uint64_t padding_bytes_after_bitmap_bytes;
+  uint64_t names_size;
+  uint64_t counters_delta;
+  uint64_t bitmap_delta;
+  uint64_t names_delta;
+  uint64_t value_kind_last;
+};
+
+static uint64_t SectionSize(const char *start, const char *stop) {
+  return start != NULL ? (uint64_t)(stop - start) : 0;
+}
+
+// Sections are padded to a multiple of 8 bytes in the file.
+static uint64_t Padding(uint64_t size) { return (8 - size % 8) % 8; }
+
+static int WriteSection(FILE *file, const char *start, uint64_t size) {
+  static const char kZeros[8];
+  return fwrite(start, 1, size, file) == size &&
+         fwrite(kZeros, 1, Padding(size), file) == Padding(size);
+}
+
+static const char *ProfileFileName(void) {
+  const char *name = getenv("LLVM_PROFILE_FILE");
+  if (name != NULL && name[0] != '\0') {
+    return name;
+  }
+  if (__llvm_profile_filename != NULL && __llvm_profile_filename[0] != '\0') {
+    return __llvm_profile_filename;
+  }
+  return "default.profraw";
+}
+
+static void WriteProfile(void) {
+  if (&__llvm_profile_raw_version == NULL) {
+    return;
+  }
+  const char *name = ProfileFileName();
+  if ((__llvm_profile_raw_version & PROFILE_VERSION_MASK) !=
+      PROFILE_RAW_VERSION) {
+    fprintf(stderr, "chovl_profile: unsupported profile version, %s not "
+                    "written\n", name);
+    return;
+  }
+
+  uint64_t data_size =
+      SectionSize(__start___llvm_prf_data, __stop___llvm_prf_data);
+  uint64_t counters_size =
+      SectionSize(__start___llvm_prf_cnts, __stop___llvm_prf_cnts);
+  uint64_t bitmap_size =
+      SectionSize(__start___llvm_prf_bits, __stop___llvm_prf_bits);
+  uint64_t names_size =
+      SectionSize(__start___llvm_prf_names, __stop___llvm_prf_names);
+
+  struct ProfileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = PROFILE_MAGIC;
+  header.version = __llvm_profile_raw_version;
+  header.num_data = data_size / sizeof(struct ProfileData);
+  header.num_counters = counters_size / sizeof(uint64_t);
+  header.padding_bytes_after_counters = Padding(counters_size);
+  header.num_bitmap_bytes = bitmap_size;
+  header.padding_bytes_after_bitmap_bytes = Padding(bitmap_size);
+  header.names_size = names_size;
+  // Data records point to their counters and bitmaps relative to
+  // themselves, which the reader resolves through these deltas.
+  header.counters_delta =
+      (uintptr_t)__start___llvm_prf_cnts - (uintptr_t)__start___llvm_prf_data;
+  header.bitmap_delta =
+      (uintptr_t)__start___llvm_prf_bits - (uintptr_t)__start___llvm_prf_data;
+  header.names_delta = (uintptr_t)__start___llvm_prf_names;
+  header.value_kind_last = PROFILE_VALUE_KIND_LAST;
+
+  FILE *file = fopen(name, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "chovl_profile: could not open %s\n", name);
+    return;
+  }
+  int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+           WriteSection(file, __start___llvm_prf_data, data_size) &&
+           WriteSection(file, __start___llvm_prf_cnts, counters_size) &&
+           WriteSection(file, __start___llvm_prf_bits, bitmap_size) &&
+           WriteSection(file, __start___llvm_prf_names, names_size);
+  if (fclose(file) != 0 || !ok) {
+    fprintf(stderr, "chovl_profile: could not write %s\n", name);
+  }
+}
+
+__attribute__((constructor)) static void RegisterProfileWriter(void) {
+  atexit(WriteProfile);
+}
@@ -0,0 +1,41 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace chovl {
+
+namespace {
+size_t Padding(const std::byte* p, size_t alignment) {
+  return -reinterpret_cast<uintptr_t>(p) & (alignment - 1);
+}
+}  // namespace
+
+Arena::~Arena() {
+  for (auto it = destructors_.rbegin(); it != destructors_.rend(); ++it) {
+    it->destroy(it->object);
+  }
+}
+
+std::string_view Arena::CopyString(std::string_view text) {
+  char* copy = static_cast<char*>(Allocate(text.size(), 1));
+  memcpy(copy, text.data(), text.size());
+  return {copy, text.size()};
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+  size_t available = end_ - cursor_;
+  if (cursor_ == nullptr || available < Padding(cursor_, alignment) + size) {
+    size_t block_size = std::max(kBlockSize, size + alignment);
+    blocks_.emplace_back(new std::byte[block_size]);
+    cursor_ = blocks_.back().get();
+    end_ = cursor_ + block_size;
+  }
+
+  std::byte* result = cursor_ + Padding(cursor_, alignment);
+  cursor_ = result + size;
+  return result;
+}
+
+}  // namespace chovl
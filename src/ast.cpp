@@ -1,6 +1,17 @@
 #include "ast.h"
 
+#include <llvm/ADT/StringExtras.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Support/MathExtras.h>
+
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <set>
+#include <utility>
+
+#include "builtins.h"
+#include "timing.h"
 
 namespace chovl {
 
@@ -17,19 +28,42 @@ llvm::Value* CastValue(Context& context, llvm::Value* src, llvm::Type* src_type,
     return src;
   }
 
-  if (src_type->isIntegerTy() && dst_type->isIntegerTy()) {
+  // Casting a scalar to a vector type converts it to the type of the lanes
+  // and splats it.
+  auto* src_vector = llvm::dyn_cast<llvm::FixedVectorType>(src_type);
+  auto* dst_vector = llvm::dyn_cast<llvm::FixedVectorType>(dst_type);
+  if (dst_vector && !src_type->isVectorTy() && !src_type->isAggregateType()) {
+    llvm::Type* element_type = dst_vector->getElementType();
+    src = CastValue(context, src, src_type, element_type);
+    return context.llvm_builder->CreateVectorSplat(
+        dst_vector->getNumElements(), src, "splat");
+  }
+
+  // Otherwise vectors can only be cast lane by lane to vectors of the same
+  // width.
+  bool same_shape =
+      src_vector == nullptr
+          ? dst_vector == nullptr
+          : dst_vector != nullptr &&
+                src_vector->getNumElements() == dst_vector->getNumElements();
+
+  if (same_shape && src_type->isIntOrIntVectorTy() &&
+      dst_type->isIntOrIntVectorTy()) {
     return context.llvm_builder->CreateIntCast(src, dst_type, true);
   }
 
-  if (src_type->isFloatingPointTy() && dst_type->isFloatingPointTy()) {
+  if (same_shape && src_type->isFPOrFPVectorTy() &&
+      dst_type->isFPOrFPVectorTy()) {
     return context.llvm_builder->CreateFPCast(src, dst_type);
   }
 
-  if (src_type->isIntegerTy() && dst_type->isFloatingPointTy()) {
+  if (same_shape && src_type->isIntOrIntVectorTy() &&
+      dst_type->isFPOrFPVectorTy()) {
     return context.llvm_builder->CreateSIToFP(src, dst_type);
   }
 
-  if (src_type->isFloatingPointTy() && dst_type->isIntegerTy()) {
+  if (same_shape && src_type->isFPOrFPVectorTy() &&
+      dst_type->isIntOrIntVectorTy()) {
     return context.llvm_builder->CreateFPToSI(src, dst_type);
   }
 
@@ -44,6 +78,112 @@ llvm::Value* CastValue(Context& context, llvm::Value* src, llvm::Type* src_type,
   throw std::runtime_error(rso.str());
 }
 
+llvm::Value* CreateSlice(Context& context, llvm::Value* ptr,
+                         llvm::Value* length) {
+  llvm::Value* slice =
+      llvm::PoisonValue::get(GetSliceType(*context.llvm_context));
+  slice = context.llvm_builder->CreateInsertValue(slice, ptr, 0);
+  return context.llvm_builder->CreateInsertValue(slice, length, 1, "slice");
+}
+
+// Loads the pointer to the first element of the slice stored at `slice`.
+llvm::Value* LoadSlicePointer(Context& context, llvm::Value* slice,
+                              llvm::StringRef name) {
+  llvm::Value* ptr_field = context.llvm_builder->CreateStructGEP(
+      GetSliceType(*context.llvm_context), slice, 0);
+  return context.llvm_builder->CreateLoad(
+      llvm::PointerType::get(*context.llvm_context, 0), ptr_field, name);
+}
+
+llvm::Value* LoadSliceLength(Context& context, llvm::Value* slice) {
+  llvm::Value* length_field = context.llvm_builder->CreateStructGEP(
+      GetSliceType(*context.llvm_context), slice, 1);
+  return context.llvm_builder->CreateLoad(context.llvm_builder->getInt32Ty(),
+                                          length_field, "len");
+}
+
+// Returns a private global that holds `value` in read-only data. Its address
+// is insignificant, so LLVM may also merge it with equal constants of other
+// modules.
+llvm::GlobalVariable* GetConstantData(Context& context, llvm::Constant* value) {
+  llvm::GlobalVariable*& global = context.constant_data[value];
+  if (global == nullptr) {
+    auto* data = llvm::dyn_cast<llvm::ConstantDataSequential>(value);
+    bool is_string = data != nullptr && data->isCString();
+    global = new llvm::GlobalVariable(*context.llvm_module, value->getType(),
+                                      /*isConstant=*/true,
+                                      llvm::GlobalValue::PrivateLinkage, value,
+                                      is_string ? ".str" : ".const");
+    global->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    global->setAlignment(
+        context.llvm_module->getDataLayout().getABITypeAlign(value->getType()));
+  }
+  return global;
+}
+
+// Initializes the memory at `ptr`, which holds a `type`, with the constant
+// array or struct `value` through a single memcpy from read-only data,
+// instead of materializing it in registers every time.
+void CreateConstantCopy(Context& context, llvm::Value* ptr, llvm::Type* type,
+                        llvm::Constant* value, std::string_view name) {
+  const llvm::DataLayout& layout = context.llvm_module->getDataLayout();
+  uint64_t size = layout.getTypeAllocSize(value->getType());
+  if (size > layout.getTypeAllocSize(type)) {
+    throw std::runtime_error("The initializer of " + std::string(name) +
+                             " does not fit its type");
+  }
+  llvm::Align align = layout.getABITypeAlign(value->getType());
+  context.llvm_builder->CreateMemCpy(
+      ptr, align, GetConstantData(context, value), align, size);
+}
+
+void CheckAssignable(const SymbolicValue& sym, std::string_view name) {
+  if (sym.is_constant()) {
+    throw std::runtime_error("Cannot assign to constant " + std::string(name));
+  }
+}
+
+// Whether the type is a pointer to a single element, e.g. `i32&`.
+bool IsPointer(const Type& type) {
+  return type.indirection() == IndirectionType::kPointer &&
+         type.aggregate_kind() == AggregateType::kSingular;
+}
+
+// Returns the alignment of a variable of `type`, whose LLVM type is aligned
+// to `align`, raised to the one of @align(N) on its struct.
+llvm::Align VariableAlign(const Type& type, llvm::Align align) {
+  return std::max(align, llvm::Align(std::max<uint32_t>(type.alignment(), 1)));
+}
+
+// Structs are initialized and multi-assigned with exactly one value per
+// field.
+void CheckFieldCount(const StructInfo& info, size_t count,
+                     std::string_view name) {
+  if (count != info.fields().size()) {
+    throw std::runtime_error(
+        "Struct " + std::string(info.name().name) + " has " +
+        std::to_string(info.fields().size()) + " fields, but " +
+        std::string(name) + " is given " + std::to_string(count) + " values");
+  }
+}
+
+// Returns the struct of `info` with one constant per field. The padding of
+// @align(N) is zeroed.
+llvm::Constant* GetConstantStruct(Context& context, const StructInfo& info,
+                                  const std::vector<llvm::Value*>& values) {
+  llvm::StructType* type = info.llvm_type(context);
+  std::vector<llvm::Constant*> elements;
+  for (unsigned i = 0; i < type->getNumElements(); ++i) {
+    llvm::Type* element_type = type->getElementType(i);
+    elements.push_back(
+        i < values.size()
+            ? llvm::cast<llvm::Constant>(CastValue(
+                  context, values[i], values[i]->getType(), element_type))
+            : llvm::Constant::getNullValue(element_type));
+  }
+  return llvm::ConstantStruct::get(type, elements);
+}
+
 llvm::Value* AssignValue(Context& context, llvm::Value* val, llvm::Value* ptr,
                          llvm::Type* type) {
   if (val->getType() != type) {
@@ -52,19 +192,184 @@ llvm::Value* AssignValue(Context& context, llvm::Value* val, llvm::Value* ptr,
   return context.llvm_builder->CreateStore(val, ptr);
 }
 
+bool IsIntrinsicDeclaration(std::string_view line) {
+  return line.starts_with("declare ") && line.find(" @llvm.") != line.npos;
+}
+
+// Adds the attribute groups that `line` refers to, like `#0`, to `groups`.
+void CollectAttributeGroups(std::string_view line, std::set<unsigned>& groups) {
+  for (size_t pos = line.find('#'); pos != line.npos;
+       pos = line.find('#', pos + 1)) {
+    unsigned group = 0;
+    auto [end, error] = std::from_chars(line.data() + pos + 1,
+                                        line.data() + line.size(), group);
+    if (error == std::errc()) {
+      groups.insert(group);
+    }
+  }
+}
+
+// Prints the declaration of `func` from its type alone, without attributes,
+// e.g. `declare void @llvm.trap()`.
+void PrintPlainDeclaration(llvm::raw_ostream& out, const Function& func) {
+  out << "declare " << *func.getReturnType() << " @" << func.getName() << "(";
+  llvm::ListSeparator separator;
+  for (llvm::Type* param : func.getFunctionType()->params()) {
+    out << separator << *param;
+  }
+  out << ")\n";
+}
+
 }  // namespace
 
-AST::AST(ASTAggregateNode* root) : root_(root) {}
+Identifier AST::Intern(std::string_view name) {
+  auto it = symbol_ids_.find(name);
+  if (it == symbol_ids_.end()) {
+    it = symbol_ids_.emplace(arena_.CopyString(name), symbol_ids_.size()).first;
+  }
+  return {it->second, it->first};
+}
+
+StructInfo* AST::DeclareStruct(std::string_view name,
+                               const AttributeList* attributes) {
+  Identifier identifier = Intern(name);
+  if (struct_ids_.count(identifier.id) != 0) {
+    throw std::runtime_error("Redefinition of struct " + std::string(name));
+  }
+  auto* info = New<StructInfo>(identifier);
+  structs_.push_back(info);
+  struct_ids_[identifier.id] = info;
+  if (attributes == nullptr) {
+    return info;
+  }
+
+  for (const Attribute& attribute : *attributes) {
+    const std::string& attribute_name = attribute.name;
+    if (attribute_name == "packed" && !attribute.argument) {
+      info->set_packed();
+    } else if (attribute_name == "soa" && !attribute.argument) {
+      info->set_soa();
+    } else if (attribute_name == "align" && attribute.argument) {
+      if (*attribute.argument < 1 ||
+          !llvm::isPowerOf2_32(static_cast<uint32_t>(*attribute.argument))) {
+        throw std::runtime_error("The argument of @align must be a power "
+                                 "of two");
+      }
+      info->set_alignment(static_cast<uint32_t>(*attribute.argument));
+    } else {
+      throw std::runtime_error("Invalid struct attribute: @" + attribute_name);
+    }
+  }
+  return info;
+}
+
+void AST::DefineStruct(StructInfo* info, FieldList* fields) {
+  std::string name(info->name().name);
+  for (auto field = fields->begin(); field != fields->end(); ++field) {
+    std::string field_name(field->name.name);
+    for (auto other = fields->begin(); other != field; ++other) {
+      if (other->name.id == field->name.id) {
+        throw std::runtime_error("Duplicate field " + field_name +
+                                 " in struct " + name);
+      }
+    }
+    if (field->type.struct_info() == info &&
+        field->type.indirection() == IndirectionType::kNone &&
+        field->type.aggregate_kind() != AggregateType::kSlice) {
+      throw std::runtime_error("Struct " + name + " cannot contain itself");
+    }
+    // Every field of a structure of arrays becomes an array of its own.
+    if (info->is_soa() &&
+        field->type.aggregate_kind() != AggregateType::kSingular) {
+      throw std::runtime_error("Field " + field_name + " of @soa struct " +
+                               name + " cannot be an array or slice");
+    }
+  }
+  info->set_fields(std::move(*fields));
+}
+
+const StructInfo* AST::GetStruct(std::string_view name) {
+  auto it = struct_ids_.find(Intern(name).id);
+  if (it == struct_ids_.end()) {
+    throw std::runtime_error("Unknown struct " + std::string(name));
+  }
+  return it->second;
+}
 
 void AST::codegen() {
-  std::vector<llvm::Value*> vals = root_->codegen_aggregate(llvm_context);
-  std::string type_str;
-  llvm::raw_string_ostream rso(type_str);
-  for (auto val : vals) {
-    val->print(rso);
-    rso << "\n";
+  {
+    PhaseScope scope(llvm_context.time_report, "Fold constants");
+    root_->fold(*this);
+  }
+  root_->codegen_aggregate(llvm_context);
+}
+
+void AST::print(llvm::raw_ostream& out) {
+  // The module is printed as a whole, so that attribute groups and metadata
+  // are numbered the same way in the functions and below them. Its header,
+  // which names the file and the target, is left out. The attributes of
+  // intrinsics change between LLVM versions, so intrinsics are declared from
+  // their types alone, which still assembles, and only the attribute groups
+  // of the other functions and calls are printed.
+  std::string text;
+  llvm::raw_string_ostream module_out(text);
+  llvm_context.llvm_module->print(module_out, nullptr);
+  module_out.flush();
+
+  std::vector<std::string_view> lines;
+  for (std::string_view rest = text; !rest.empty();) {
+    size_t end = rest.find('\n');
+    lines.push_back(rest.substr(0, end));
+    rest.remove_prefix(end == std::string_view::npos ? rest.size() : end + 1);
+  }
+  std::set<unsigned> used_groups;
+  for (std::string_view line : lines) {
+    if (!line.starts_with("attributes #") &&
+        !IsIntrinsicDeclaration(line)) {
+      CollectAttributeGroups(line, used_groups);
+    }
+  }
+
+  std::string_view attrs_comment;
+  bool after_blank = true;
+  for (std::string_view line : lines) {
+    if (line.starts_with("; ModuleID") || line.starts_with("source_filename") ||
+        line.starts_with("target ")) {
+      continue;
+    }
+    std::string_view group_prefix = "attributes #";
+    if (line.starts_with(group_prefix)) {
+      unsigned group = 0;
+      std::from_chars(line.data() + group_prefix.size(),
+                      line.data() + line.size(), group);
+      if (!used_groups.contains(group)) {
+        continue;
+      }
+    }
+    // The comment belongs to the declaration or definition that follows.
+    if (line.starts_with("; Function Attrs:")) {
+      attrs_comment = line;
+      continue;
+    }
+    if (IsIntrinsicDeclaration(line)) {
+      std::string_view name = line.substr(line.find(" @llvm.") + 2);
+      name = name.substr(0, name.find('('));
+      PrintPlainDeclaration(
+          out, *llvm_context.llvm_module->getFunction(llvm::StringRef(name)));
+      attrs_comment = {};
+      after_blank = false;
+      continue;
+    }
+    if (line.empty() && after_blank) {
+      continue;
+    }
+    if (!attrs_comment.empty()) {
+      out << attrs_comment << "\n";
+      attrs_comment = {};
+    }
+    out << line << "\n";
+    after_blank = line.empty();
   }
-  std::cout << rso.str();
 }
 
 llvm::Value* I32Node::codegen(Context& context) {
@@ -72,21 +377,165 @@ llvm::Value* I32Node::codegen(Context& context) {
 }
 
 llvm::Value* F32Node::codegen(Context& context) {
-  return ConstantFP::get(llvm::Type::getFloatTy(context.llvm_context), value_);
+  return ConstantFP::get(llvm::Type::getFloatTy(*context.llvm_context),
+                         value_);
+}
+
+llvm::Value* BoolNode::codegen(Context& context) {
+  return context.llvm_builder->getInt1(value_);
+}
+
+llvm::Value* DeadCodeNode::codegen(Context& context) {
+  llvm::IRBuilder<>& builder = *context.llvm_builder;
+  llvm::Module& module = *context.llvm_module;
+  BasicBlock* live_block = builder.GetInsertBlock();
+  llvm::GlobalVariable* last_global =
+      module.global_empty() ? nullptr : &*std::prev(module.global_end());
+
+  // The dead code gets a function of its own, so that neither its allocas
+  // nor its names show up in the live one. It still uses the allocas of the
+  // live function, which is fine since it is never emitted.
+  Function* dead_func = Function::Create(
+      live_block->getParent()->getFunctionType(),
+      llvm::GlobalValue::PrivateLinkage, "", module);
+  builder.SetInsertPoint(BasicBlock::Create(*context.llvm_context, "entry",
+                                            dead_func));
+  BoundsCheckStats stats = context.bounds_check_stats;
+  llvm::BasicBlock* bounds_trap = std::exchange(context.bounds_trap, nullptr);
+  std::vector<llvm::CallInst*> tail_calls = std::move(context.tail_calls);
+  context.tail_calls.clear();
+
+  // The dead code uses values of the live function, so it also has to go
+  // when it has errors.
+  auto erase_dead_func = [&] {
+    dead_func->eraseFromParent();
+    delete context.bounds_trap;
+    context.bounds_trap = bounds_trap;
+    context.bounds_check_stats = stats;
+    context.tail_calls = std::move(tail_calls);
+  };
+  try {
+    dead_->codegen(context);
+  } catch (...) {
+    erase_dead_func();
+    throw;
+  }
+
+  std::vector<Function*> new_functions;
+  for (auto it = std::next(dead_func->getIterator()); it != module.end();
+       ++it) {
+    new_functions.push_back(&*it);
+  }
+  erase_dead_func();
+  // Drop the intrinsics and constant data only the dead code used.
+  for (Function* func : new_functions) {
+    if (func->use_empty()) {
+      func->eraseFromParent();
+    }
+  }
+  auto global = last_global == nullptr ? module.global_begin()
+                                       : std::next(last_global->getIterator());
+  while (global != module.global_end()) {
+    llvm::GlobalVariable& dead_global = *global++;
+    if (dead_global.use_empty()) {
+      context.constant_data.erase(dead_global.getInitializer());
+      dead_global.eraseFromParent();
+    }
+  }
+
+  builder.SetInsertPoint(live_block);
+  return value_->codegen(context);
 }
 
 llvm::Value* BinaryExprNode::codegen(Context& context) {
   llvm::Value* lhs = lhs_->codegen(context);
+  // On integers and vectors, && and || stay bitwise operations.
+  if ((op_ == Operator::kAnd || op_ == Operator::kOr) &&
+      lhs->getType()->isIntegerTy(1)) {
+    return CreateShortCircuit(context, lhs);
+  }
   llvm::Value* rhs = rhs_->codegen(context);
 
   return CreateBinaryOperation(context.llvm_builder.get(), op_, lhs, rhs);
 }
 
+llvm::Value* BinaryExprNode::CreateShortCircuit(Context& context,
+                                                llvm::Value* lhs) {
+  bool is_and = op_ == Operator::kAnd;
+  Function* curr_func = context.llvm_builder->GetInsertBlock()->getParent();
+  BasicBlock* lhs_block = context.llvm_builder->GetInsertBlock();
+  BasicBlock* rhs_block = BasicBlock::Create(
+      *context.llvm_context, is_and ? "and.rhs" : "or.rhs", curr_func);
+  BasicBlock* merge_block = BasicBlock::Create(*context.llvm_context,
+                                               is_and ? "and.end" : "or.end");
+
+  if (is_and) {
+    context.llvm_builder->CreateCondBr(lhs, rhs_block, merge_block);
+  } else {
+    context.llvm_builder->CreateCondBr(lhs, merge_block, rhs_block);
+  }
+
+  context.llvm_builder->SetInsertPoint(rhs_block);
+  llvm::Value* rhs = rhs_->codegen(context);
+  if (rhs->getType() != lhs->getType()) {
+    std::string error_str = "BinaryExprNode: lhs and rhs types do not match: ";
+    llvm::raw_string_ostream rso(error_str);
+    lhs->getType()->print(rso);
+    rso << " vs ";
+    rhs->getType()->print(rso);
+    throw std::runtime_error(rso.str());
+  }
+  context.llvm_builder->CreateBr(merge_block);
+  rhs_block = context.llvm_builder->GetInsertBlock();
+
+  curr_func->insert(curr_func->end(), merge_block);
+  context.llvm_builder->SetInsertPoint(merge_block);
+  llvm::PHINode* phi_node = context.llvm_builder->CreatePHI(
+      lhs->getType(), 2, is_and ? "andtmp" : "ortmp");
+  // Coming straight from the left-hand side means that it decided the result.
+  phi_node->addIncoming(context.llvm_builder->getInt1(!is_and), lhs_block);
+  phi_node->addIncoming(rhs, rhs_block);
+  return phi_node;
+}
+
 TypeNode::TypeNode(Type type) : type_(type) {}
 
-ParameterNode::ParameterNode(TypeNode* type, const char* name)
+ParameterNode::ParameterNode(TypeNode* type, Identifier name)
     : type_(type), name_(name) {}
 
+void ParameterNode::apply_attributes(Context& context, llvm::Argument& arg) {
+  if (attributes_ == nullptr) {
+    return;
+  }
+  if (!arg.getType()->isPointerTy()) {
+    throw std::runtime_error("Attributes of parameter " +
+                             std::string(name_.name) +
+                             " require a pointer parameter");
+  }
+
+  for (const Attribute& attribute : *attributes_) {
+    const std::string& name = attribute.name;
+    if (name == "noalias" && !attribute.argument) {
+      arg.addAttr(llvm::Attribute::NoAlias);
+    } else if (name == "nonnull" && !attribute.argument) {
+      arg.addAttr(llvm::Attribute::NonNull);
+    } else if (name == "dereferenceable" && attribute.argument) {
+      if (*attribute.argument < 1) {
+        throw std::runtime_error("The argument of @" + name +
+                                 " must be positive");
+      }
+      // The argument counts elements, while LLVM counts bytes.
+      llvm::Type* element_type = type().element().llvm_type(context);
+      uint64_t bytes =
+          context.llvm_module->getDataLayout().getTypeAllocSize(element_type);
+      arg.addAttrs(llvm::AttrBuilder(*context.llvm_context)
+                       .addDereferenceableAttr(bytes * *attribute.argument));
+    } else {
+      throw std::runtime_error("Invalid parameter attribute: @" + name);
+    }
+  }
+}
+
 std::vector<llvm::Value*> ASTListNode::codegen_aggregate(Context& context) {
   std::vector<llvm::Value*> vals;
   vals.reserve(nodes_.size());
@@ -96,10 +545,19 @@ std::vector<llvm::Value*> ASTListNode::codegen_aggregate(Context& context) {
   return vals;
 }
 
-FunctionDeclNode::FunctionDeclNode(const char* identifier,
+void ASTListNode::mark_tail_position() {
+  if (!nodes_.empty()) {
+    nodes_.back()->mark_tail_position();
+  }
+}
+
+FunctionDeclNode::FunctionDeclNode(std::string_view identifier,
                                    ParameterListNode* params,
                                    TypeNode* return_type)
-    : identifier_(identifier), params_(params), return_type_(return_type) {}
+    : ASTNode(NodeKind::kFunctionDecl),
+      identifier_(identifier),
+      params_(params),
+      return_type_(return_type) {}
 
 llvm::Value* FunctionDeclNode::codegen(Context& context) {
   std::vector<llvm::Type*> param_types;
@@ -114,55 +572,257 @@ llvm::Value* FunctionDeclNode::codegen(Context& context) {
 
   unsigned idx = 0;
   for (auto& arg : func->args()) {
-    arg.setName(params_->nodes()[idx++]->name());
+    ParameterNode* param = params_->nodes()[idx++];
+    arg.setName(param->name().name);
+    param->apply_attributes(context, arg);
   }
+  ApplyAttributes(func);
 
   return func;
 }
 
+void FunctionDeclNode::ApplyAttributes(Function* func) {
+  if (attributes_ == nullptr) {
+    return;
+  }
+
+  for (const Attribute& attribute : *attributes_) {
+    const std::string& name = attribute.name;
+    if (attribute.argument) {
+      throw std::runtime_error("Invalid function attribute: @" + name +
+                               " does not take an argument");
+    }
+
+    if (name == "inline") {
+      func->addFnAttr(llvm::Attribute::AlwaysInline);
+    } else if (name == "noinline") {
+      func->addFnAttr(llvm::Attribute::NoInline);
+    } else if (name == "pure" || name == "readonly") {
+      func->setMemoryEffects(name == "pure" ? llvm::MemoryEffects::none()
+                                            : llvm::MemoryEffects::readOnly());
+      // Without these, calls could only be combined, not removed or hoisted
+      // out of loops.
+      func->setWillReturn();
+      func->setDoesNotThrow();
+    } else if (name == "cold") {
+      func->addFnAttr(llvm::Attribute::Cold);
+    } else {
+      throw std::runtime_error("Invalid function attribute: @" + name);
+    }
+  }
+
+  if (func->hasFnAttribute(llvm::Attribute::AlwaysInline) &&
+      func->hasFnAttribute(llvm::Attribute::NoInline)) {
+    throw std::runtime_error("Function " + identifier_ +
+                             " cannot be both @inline and @noinline");
+  }
+}
+
 FunctionDefNode::FunctionDefNode(ASTNode* decl, ASTNode* body)
-    : decl_(dynamic_cast<FunctionDeclNode*>(decl)), body_(body) {}
+    : ASTNode(NodeKind::kFunctionDef),
+      decl_(llvm::cast<FunctionDeclNode>(decl)),
+      body_(body) {
+  body_->mark_tail_position();
+}
 
 llvm::Value* FunctionDefNode::codegen(Context& context) {
+  PhaseScope scope(context.time_report, "Codegen function",
+                   decl_->identifier());
   Function* func = static_cast<Function*>(decl_->codegen(context));
   if (!func) {
     return nullptr;
   }
 
-  BasicBlock* block = BasicBlock::Create(context.llvm_context, "entry", func);
+  BasicBlock* block =
+      BasicBlock::Create(*context.llvm_context, "entry", func);
   context.llvm_builder->SetInsertPoint(block);
 
   context.symbol_table->AddScope();
   // We need to create alloca for each argument to store them in the symbol
   // table. This gets optimized away by LLVM, so it's fine.
+  auto& params = decl_->params()->nodes();
   for (auto& arg : func->args()) {
+    ParameterNode* param = params[arg.getArgNo()];
     llvm::AllocaInst* alloca = context.llvm_builder->CreateAlloca(
         arg.getType(), nullptr, arg.getName());
+    alloca->setAlignment(VariableAlign(param->type(), alloca->getAlign()));
     context.llvm_builder->CreateStore(&arg, alloca);
-    context.symbol_table->AddSymbol(std::string(arg.getName()),
-                                    {&arg, alloca, Type(arg.getType())});
+    context.symbol_table->AddSymbol(param->name().id,
+                                    {&arg, alloca, param->type()});
   }
 
+  context.tail_calls.clear();
+  context.bounds_trap = nullptr;
   context.llvm_builder->CreateRet(body_->codegen(context));
+  // Failed bounds checks trap at the very end, out of the way of the code
+  // that runs.
+  if (context.bounds_trap != nullptr) {
+    func->insert(func->end(), context.bounds_trap);
+    context.bounds_trap = nullptr;
+  }
 
   context.symbol_table->RemoveScope();
+  LowerTailCalls(*func, context.tail_calls, context.tail_call_mode);
 
-  llvm::verifyFunction(*func);
+  {
+    PhaseScope verify_scope(context.time_report, "Verify function",
+                            decl_->identifier());
+    llvm::verifyFunction(*func);
+  }
 
   return func;
 }
 
+GlobalVariableNode::GlobalVariableNode(TypeNode* type, Identifier name,
+                                       ASTAggregateNode* values)
+    : ASTNode(NodeKind::kGlobalVariable),
+      type_(type),
+      name_(name),
+      values_(values ? llvm::cast<ASTListNode>(values) : nullptr) {}
+
+llvm::Value* GlobalVariableNode::codegen(Context& context) {
+  if (context.llvm_module->getNamedValue(name_.name) != nullptr) {
+    throw std::runtime_error("Redefinition of " + std::string(name_.name));
+  }
+  // Initializers are folded to constants without emitting any instructions,
+  // so nothing may be inserted into the function before.
+  context.llvm_builder->ClearInsertionPoint();
+
+  llvm::Type* llvm_type = type_->llvm_type(context);
+  llvm::Constant* initializer = values_ != nullptr
+                                    ? Initializer(context, llvm_type)
+                                    : llvm::Constant::getNullValue(llvm_type);
+  auto* global = new llvm::GlobalVariable(
+      *context.llvm_module, llvm_type, is_constant_,
+      llvm::GlobalValue::ExternalLinkage, initializer, name_.name);
+  global->setAlignment(VariableAlign(
+      type_->get(),
+      context.llvm_module->getDataLayout().getABITypeAlign(llvm_type)));
+  context.symbol_table->AddSymbol(
+      name_.id, {nullptr, global, type_->get(), is_constant_});
+  return global;
+}
+
+llvm::Constant* GlobalVariableNode::Initializer(Context& context,
+                                                llvm::Type* type) {
+  std::vector<llvm::Constant*> values;
+  for (ASTNode* node : values_->nodes()) {
+    if (!llvm::isa<I32Node, F32Node, CharNode, BoolNode, StringLiteralNode>(
+            node)) {
+      throw std::runtime_error("The initializer of " +
+                               std::string(name_.name) + " is not constant");
+    }
+    values.push_back(llvm::cast<llvm::Constant>(node->codegen(context)));
+  }
+  auto cast = [&](llvm::Constant* value, llvm::Type* dst_type) {
+    return llvm::cast<llvm::Constant>(
+        CastValue(context, value, value->getType(), dst_type));
+  };
+
+  Type global_type = type_->get();
+  if (global_type.kind() == PrimitiveType::kStruct &&
+      global_type.aggregate_kind() == AggregateType::kSingular &&
+      global_type.indirection() == IndirectionType::kNone) {
+    CheckFieldCount(*global_type.struct_info(), values.size(), name_.name);
+    return GetConstantStruct(
+        context, *global_type.struct_info(),
+        std::vector<llvm::Value*>(values.begin(), values.end()));
+  }
+
+  // A string literal initializes a char array, and the rest of the array is
+  // zeroed.
+  auto* string = llvm::dyn_cast<llvm::ConstantDataArray>(values.front());
+  if (values.size() == 1 && string != nullptr && type->isArrayTy()) {
+    std::string data = string->getAsString().str();
+    if (type->getArrayElementType() != string->getElementType() ||
+        data.size() > type->getArrayNumElements()) {
+      throw std::runtime_error("The initializer of " +
+                               std::string(name_.name) +
+                               " does not fit its type");
+    }
+    data.resize(type->getArrayNumElements());
+    return llvm::ConstantDataArray::getString(*context.llvm_context, data,
+                                              /*AddNull=*/false);
+  }
+
+  // Like in a multi-assignment, the last value fills the remaining elements
+  // of arrays and lanes of vectors.
+  auto fill = [&](llvm::Type* element_type, size_t size) {
+    std::vector<llvm::Constant*> elements;
+    for (size_t i = 0; i < size; ++i) {
+      elements.push_back(
+          cast(i < values.size() ? values[i] : values.back(), element_type));
+    }
+    return elements;
+  };
+  if (auto* array_type = llvm::dyn_cast<llvm::ArrayType>(type)) {
+    return llvm::ConstantArray::get(
+        array_type,
+        fill(array_type->getElementType(), array_type->getNumElements()));
+  }
+  if (auto* vector_type = llvm::dyn_cast<llvm::FixedVectorType>(type)) {
+    return llvm::ConstantVector::get(
+        fill(vector_type->getElementType(), vector_type->getNumElements()));
+  }
+  if (values.size() != 1) {
+    throw std::runtime_error("Too many values for " + std::string(name_.name));
+  }
+  return cast(values.front(), type);
+}
+
 CastOpNode::CastOpNode(TypeNode* type, ASTNode* value)
-    : type_(type), value_(value) {}
+    : ASTNode(NodeKind::kCastOp), type_(type), value_(value) {}
 
 llvm::Value* CastOpNode::codegen(Context& context) {
   llvm::Type* dst_type = type_->llvm_type(context);
+
+  // Arrays are cast to pointers and slices through their address, without
+  // loading them.
+  auto* assignable = llvm::dyn_cast<AssignableNode>(value_);
+  bool is_array = assignable != nullptr &&
+                  assignable->type(context).aggregate_kind() ==
+                      AggregateType::kArray;
+  if (is_array && type_->get().aggregate_kind() == AggregateType::kSlice) {
+    Type src_type = assignable->type(context);
+    if (src_type.is_soa()) {
+      throw std::runtime_error("A structure of arrays cannot be sliced");
+    }
+    if (src_type.kind() != type_->get().kind() ||
+        src_type.struct_info() != type_->get().struct_info()) {
+      throw std::runtime_error("Cannot cast an array to a slice of another "
+                               "element type");
+    }
+    return CreateSlice(context, assignable->llvm_alloca(context),
+                       context.llvm_builder->getInt32(src_type.size()));
+  }
+
   llvm::Value* src = value_->codegen(context);
   llvm::Type* src_type = src->getType();
 
+  // String literals are cast to pointers and slices through their constant
+  // in read-only data. A slice leaves out the terminating null character.
+  if (llvm::isa<StringLiteralNode>(value_) &&
+      (dst_type->isPointerTy() ||
+       type_->get().aggregate_kind() == AggregateType::kSlice)) {
+    llvm::GlobalVariable* global =
+        GetConstantData(context, llvm::cast<llvm::Constant>(src));
+    if (dst_type->isPointerTy()) {
+      return global;
+    }
+    if (type_->get().kind() != PrimitiveType::kChar) {
+      throw std::runtime_error("Cannot cast a string to a slice of another "
+                               "element type");
+    }
+    return CreateSlice(
+        context, global,
+        context.llvm_builder->getInt32(src_type->getArrayNumElements() - 1));
+  }
+
   if (src_type->isArrayTy() && dst_type->isPointerTy()) {
-    llvm::Value* ptr =
-        dynamic_cast<AssignableNode*>(value_.get())->llvm_alloca(context);
+    if (assignable == nullptr) {
+      throw std::runtime_error("Cannot take the address of an expression");
+    }
+    llvm::Value* ptr = assignable->llvm_alloca(context);
     return context.llvm_builder->CreateGEP(src_type->getArrayElementType(), ptr,
                                            context.llvm_builder->getInt32(0));
   }
@@ -170,15 +830,24 @@ llvm::Value* CastOpNode::codegen(Context& context) {
   return CastValue(context, src, src_type, dst_type);
 }
 
-FunctionCallNode::FunctionCallNode(const char* identifier,
+FunctionCallNode::FunctionCallNode(std::string_view identifier,
                                    ASTAggregateNode* params)
-    : identifier_(identifier), params_(params) {}
+    : ASTNode(NodeKind::kFunctionCall),
+      identifier_(identifier),
+      params_(params) {}
 
 llvm::Value* FunctionCallNode::codegen(Context& context) {
   Function* func = context.llvm_module->getFunction(identifier_);
   if (!func) {
-    std::cerr << "Function not found: " << identifier_ << "\n";
-    return nullptr;
+    if (llvm::Value* length = CreateVariableLength(context)) {
+      return length;
+    }
+    std::vector<llvm::Value*> args = params_->codegen_aggregate(context);
+    if (llvm::Value* result = CreateBuiltinCall(context.llvm_builder.get(),
+                                                identifier_, args)) {
+      return result;
+    }
+    throw std::runtime_error("Function not found: " + identifier_);
   }
 
   std::vector<llvm::Value*> args = params_->codegen_aggregate(context);
@@ -198,11 +867,42 @@ llvm::Value* FunctionCallNode::codegen(Context& context) {
     }
   }
 
-  return context.llvm_builder->CreateCall(func, args);
+  llvm::CallInst* call = context.llvm_builder->CreateCall(func, args);
+  if (is_tail_call_) {
+    context.tail_calls.push_back(call);
+  }
+  return call;
+}
+
+llvm::Value* FunctionCallNode::CreateVariableLength(Context& context) {
+  auto* params = llvm::dyn_cast<ASTListNode>(params_);
+  if (identifier_ != "len" || params == nullptr ||
+      params->nodes().size() != 1) {
+    return nullptr;
+  }
+  auto* variable = llvm::dyn_cast<VariableNode>(params->nodes().front());
+  if (variable == nullptr) {
+    return nullptr;
+  }
+  // Arrays, including structures of arrays, have a constant length, and
+  // slices only need their length field.
+  Type type = variable->type(context);
+  if (type.indirection() != IndirectionType::kNone) {
+    return nullptr;
+  }
+  switch (type.aggregate_kind()) {
+    case AggregateType::kArray:
+      return context.llvm_builder->getInt32(type.size());
+    case AggregateType::kSlice:
+      return LoadSliceLength(context, variable->llvm_alloca(context));
+    case AggregateType::kSingular:
+      break;
+  }
+  return nullptr;
 }
 
 BlockNode::BlockNode(ASTAggregateNode* body, bool is_void)
-    : body_(body), is_void_(is_void) {}
+    : ASTNode(NodeKind::kBlock), body_(body), is_void_(is_void) {}
 
 llvm::Value* BlockNode::codegen(Context& context) {
   context.symbol_table->AddScope();
@@ -220,9 +920,12 @@ llvm::Value* CharNode::codegen(Context& context) {
 }
 
 VariableDeclarationNode::VariableDeclarationNode(TypeNode* type,
-                                                 const char* name,
+                                                 Identifier name,
                                                  ASTNode* value)
-    : type_(type), name_(name), value_(value) {}
+    : ASTNode(NodeKind::kVariableDeclaration),
+      type_(type),
+      name_(name),
+      value_(value) {}
 
 llvm::Value* VariableDeclarationNode::codegen(Context& context) {
   llvm::Type* llvm_type = type_->llvm_type(context);
@@ -233,47 +936,117 @@ llvm::Value* VariableDeclarationNode::codegen(Context& context) {
                                 curr_func->getEntryBlock().begin());
 
   llvm::AllocaInst* alloca =
-      tmp_builder.CreateAlloca(llvm_type, nullptr, name_);
+      tmp_builder.CreateAlloca(llvm_type, nullptr, name_.name);
+  alloca->setAlignment(VariableAlign(type_->get(), alloca->getAlign()));
 
   llvm::Value* assigned_val = nullptr;
   if (value_ != nullptr) {
     llvm::Value* assigned_val = value_->codegen(context);
-    context.llvm_builder->CreateStore(assigned_val, alloca);
+    auto* constant = llvm::dyn_cast<llvm::Constant>(assigned_val);
+    if (constant != nullptr && constant->getType()->isArrayTy()) {
+      CreateConstantCopy(context, alloca, llvm_type, constant, name_.name);
+    } else {
+      context.llvm_builder->CreateStore(assigned_val, alloca);
+    }
   }
-  context.symbol_table->AddSymbol(name_, {assigned_val, alloca, type_->get()});
+  context.symbol_table->AddSymbol(name_.id,
+                                  {assigned_val, alloca, type_->get()});
   return nullptr;
 }
 
-VariableNode::VariableNode(const char* name) : name_(name) {}
+VariableNode::VariableNode(Identifier name)
+    : MultiAssignableNode(NodeKind::kVariable), name_(name) {}
 
 llvm::Value* VariableNode::codegen(Context& context) {
-  SymbolicValue& sym = context.symbol_table->GetSymbol(name_);
+  SymbolicValue& sym = context.symbol_table->GetSymbol(name_.id);
+  // Scalar constants are used directly instead of being loaded.
+  auto* global = llvm::dyn_cast<llvm::GlobalVariable>(sym.llvm_alloca());
+  if (sym.is_constant() && global != nullptr &&
+      !global->getValueType()->isAggregateType()) {
+    return global->getInitializer();
+  }
   return context.llvm_builder->CreateLoad(sym.llvm_type(context),
-                                          sym.llvm_alloca(), name_);
+                                          sym.llvm_alloca(), name_.name);
 }
 
 llvm::Value* VariableNode::assign(Context& context, llvm::Value* val) {
-  SymbolicValue& sym = context.symbol_table->GetSymbol(name_);
+  SymbolicValue& sym = context.symbol_table->GetSymbol(name_.id);
+  CheckAssignable(sym, name_.name);
   return AssignValue(context, val, sym.llvm_alloca(), sym.llvm_type(context));
 }
 
 llvm::Value* VariableNode::llvm_alloca(Context& context) {
-  SymbolicValue& sym = context.symbol_table->GetSymbol(name_);
+  SymbolicValue& sym = context.symbol_table->GetSymbol(name_.id);
   return sym.llvm_alloca();
 }
 
 Type VariableNode::type(Context& context) {
-  SymbolicValue& sym = context.symbol_table->GetSymbol(name_);
+  SymbolicValue& sym = context.symbol_table->GetSymbol(name_.id);
   return sym.type();
 }
 
+bool VariableNode::is_constant(Context& context) {
+  return context.symbol_table->GetSymbol(name_.id).is_constant();
+}
+
 llvm::Value* VariableNode::multi_assign(Context& context,
                                         std::vector<llvm::Value*> values) {
-  SymbolicValue& sym = context.symbol_table->GetSymbol(name_);
+  SymbolicValue& sym = context.symbol_table->GetSymbol(name_.id);
+  CheckAssignable(sym, name_.name);
+  bool all_constant = std::all_of(values.begin(), values.end(), [](auto* val) {
+    return llvm::isa<llvm::Constant>(val);
+  });
+  // Structs get one value per field.
+  Type type = sym.type();
+  if (type.kind() == PrimitiveType::kStruct &&
+      type.aggregate_kind() == AggregateType::kSingular &&
+      type.indirection() == IndirectionType::kNone) {
+    const StructInfo& info = *type.struct_info();
+    CheckFieldCount(info, values.size(), name_.name);
+    llvm::StructType* struct_type = info.llvm_type(context);
+    if (all_constant) {
+      CreateConstantCopy(context, sym.llvm_alloca(), struct_type,
+                         GetConstantStruct(context, info, values),
+                         name_.name);
+      return sym.llvm_value();
+    }
+    for (unsigned i = 0; i < values.size(); ++i) {
+      llvm::Value* ptr = context.llvm_builder->CreateStructGEP(
+          struct_type, sym.llvm_alloca(), i);
+      AssignValue(context, values[i], ptr, struct_type->getElementType(i));
+    }
+    return sym.llvm_value();
+  }
+  // The lanes of a vector are filled in a register and stored at once.
+  if (auto* vector_type =
+          llvm::dyn_cast<llvm::FixedVectorType>(sym.llvm_type(context))) {
+    llvm::Type* element_type = vector_type->getElementType();
+    llvm::Value* vector = llvm::PoisonValue::get(vector_type);
+    for (unsigned i = 0; i < vector_type->getNumElements(); ++i) {
+      llvm::Value* val = i < values.size() ? values[i] : values.back();
+      val = CastValue(context, val, val->getType(), element_type);
+      vector = context.llvm_builder->CreateInsertElement(vector, val, i);
+    }
+    context.llvm_builder->CreateStore(vector, sym.llvm_alloca());
+    return sym.llvm_value();
+  }
   if (!sym.llvm_type(context)->isArrayTy()) {
     throw std::runtime_error("Cannot multi-assign to non-array type");
   }
   size_t size = sym.llvm_type(context)->getArrayNumElements();
+  auto* array_type = llvm::cast<llvm::ArrayType>(sym.llvm_type(context));
+  if (all_constant) {
+    std::vector<llvm::Constant*> elements;
+    for (size_t i = 0; i < size; ++i) {
+      llvm::Value* val = i < values.size() ? values[i] : values.back();
+      elements.push_back(llvm::cast<llvm::Constant>(CastValue(
+          context, val, val->getType(), array_type->getElementType())));
+    }
+    CreateConstantCopy(context, sym.llvm_alloca(), array_type,
+                       llvm::ConstantArray::get(array_type, elements),
+                       name_.name);
+    return sym.llvm_value();
+  }
   for (size_t i = 0; i < size; ++i) {
     llvm::Value* val = i < values.size() ? values[i] : values.back();
     auto element_type = sym.llvm_type(context)->getArrayElementType();
@@ -286,7 +1059,9 @@ llvm::Value* VariableNode::multi_assign(Context& context,
 }
 
 AssignmentNode::AssignmentNode(AssignableNode* destination, ASTNode* value)
-    : destination_(destination), value_(value) {}
+    : ASTNode(NodeKind::kAssignment),
+      destination_(destination),
+      value_(value) {}
 
 llvm::Value* AssignmentNode::codegen(Context& context) {
   llvm::Value* val = value_->codegen(context);
@@ -294,15 +1069,16 @@ llvm::Value* AssignmentNode::codegen(Context& context) {
 }
 
 CondExprNode::CondExprNode(ASTNode* cond, ASTNode* then, ASTNode* els)
-    : cond_(cond), then_(then), else_(els) {}
+    : ASTNode(NodeKind::kCondExpr), cond_(cond), then_(then), else_(els) {}
 
 llvm::Value* CondExprNode::codegen(Context& context) {
   Function* curr_func = context.llvm_builder->GetInsertBlock()->getParent();
 
-  BasicBlock* then_block =
-      BasicBlock::Create(context.llvm_context, "then", curr_func);
-  BasicBlock* else_block = BasicBlock::Create(context.llvm_context, "else");
-  BasicBlock* merge_block = BasicBlock::Create(context.llvm_context, "ifcont");
+  // The blocks of the condition, e.g. of a short-circuit ||, come first.
+  BasicBlock* then_block = BasicBlock::Create(*context.llvm_context, "then");
+  BasicBlock* else_block = BasicBlock::Create(*context.llvm_context, "else");
+  BasicBlock* merge_block =
+      BasicBlock::Create(*context.llvm_context, "ifcont");
 
   llvm::Value* cond_val = cond_->codegen(context);
   if (else_) {
@@ -311,6 +1087,7 @@ llvm::Value* CondExprNode::codegen(Context& context) {
     context.llvm_builder->CreateCondBr(cond_val, then_block, merge_block);
   }
 
+  curr_func->insert(curr_func->end(), then_block);
   context.llvm_builder->SetInsertPoint(then_block);
   llvm::Value* then_val = then_->codegen(context);
   if (!then_val) {
@@ -343,16 +1120,27 @@ llvm::Value* CondExprNode::codegen(Context& context) {
   return phi_node;
 }
 
+void CondExprNode::mark_tail_position() {
+  then_->mark_tail_position();
+  if (else_) {
+    else_->mark_tail_position();
+  }
+}
+
 CondStatementNode::CondStatementNode(ASTNode* cond, ASTNode* then, ASTNode* els)
-    : cond_(cond), then_(then), else_(els) {}
+    : ASTNode(NodeKind::kCondStatement),
+      cond_(cond),
+      then_(then),
+      else_(els) {}
 
 llvm::Value* CondStatementNode::codegen(Context& context) {
   Function* curr_func = context.llvm_builder->GetInsertBlock()->getParent();
 
-  BasicBlock* then_block =
-      BasicBlock::Create(context.llvm_context, "then", curr_func);
-  BasicBlock* else_block = BasicBlock::Create(context.llvm_context, "else");
-  BasicBlock* merge_block = BasicBlock::Create(context.llvm_context, "ifcont");
+  // The blocks of the condition, e.g. of a short-circuit ||, come first.
+  BasicBlock* then_block = BasicBlock::Create(*context.llvm_context, "then");
+  BasicBlock* else_block = BasicBlock::Create(*context.llvm_context, "else");
+  BasicBlock* merge_block =
+      BasicBlock::Create(*context.llvm_context, "ifcont");
 
   llvm::Value* cond_val = cond_->codegen(context);
   if (else_) {
@@ -361,6 +1149,7 @@ llvm::Value* CondStatementNode::codegen(Context& context) {
     context.llvm_builder->CreateCondBr(cond_val, then_block, merge_block);
   }
 
+  curr_func->insert(curr_func->end(), then_block);
   context.llvm_builder->SetInsertPoint(then_block);
   then_->codegen(context);
   context.llvm_builder->CreateBr(merge_block);
@@ -378,52 +1167,440 @@ llvm::Value* CondStatementNode::codegen(Context& context) {
   return nullptr;
 }
 
-ArrayAccessNode::ArrayAccessNode(const char* name, ASTNode* index)
-    : name_(name), index_(index) {}
+void CondStatementNode::mark_tail_position() {
+  then_->mark_tail_position();
+  if (else_) {
+    else_->mark_tail_position();
+  }
+}
 
-llvm::Value* ArrayAccessNode::codegen(Context& context) {
-  SymbolicValue& sym = context.symbol_table->GetSymbol(name_);
-  auto element_type =
-      llvm::cast<llvm::ArrayType>(sym.llvm_alloca()->getAllocatedType())
-          ->getElementType();
+void LoopNode::CreateLatch(Context& context, BasicBlock* header) {
+  llvm::BranchInst* latch = context.llvm_builder->CreateBr(header);
+  if (llvm::MDNode* metadata = LoopMetadata(context)) {
+    latch->setMetadata(llvm::LLVMContext::MD_loop, metadata);
+  }
+}
+
+llvm::MDNode* LoopNode::LoopMetadata(Context& context) {
+  if (attributes_ == nullptr || attributes_->empty()) {
+    return nullptr;
+  }
+
+  llvm::LLVMContext& llvm_context = *context.llvm_context;
+  auto hint = [&](llvm::StringRef name, llvm::Constant* value) {
+    llvm::Metadata* operands[] = {llvm::MDString::get(llvm_context, name),
+                                  llvm::ConstantAsMetadata::get(value)};
+    return llvm::MDNode::get(llvm_context, operands);
+  };
+  auto count = [&](int32_t value) {
+    return context.llvm_builder->getInt32(value);
+  };
+
+  // The first operand is a placeholder for the self-reference that makes
+  // every loop ID distinct.
+  llvm::SmallVector<llvm::Metadata*, 4> operands = {nullptr};
+  for (const Attribute& attribute : *attributes_) {
+    const std::string& name = attribute.name;
+    if (attribute.argument && *attribute.argument < 1) {
+      throw std::runtime_error("The argument of @" + name +
+                               " must be positive");
+    }
+
+    if (name == "unroll" && !attribute.argument) {
+      operands.push_back(llvm::MDNode::get(
+          llvm_context,
+          llvm::MDString::get(llvm_context, "llvm.loop.unroll.enable")));
+    } else if (name == "unroll" && *attribute.argument > 1) {
+      operands.push_back(
+          hint("llvm.loop.unroll.count", count(*attribute.argument)));
+    } else if ((name == "unroll" || name == "nounroll") &&
+               attribute.argument.value_or(1) == 1) {
+      operands.push_back(llvm::MDNode::get(
+          llvm_context,
+          llvm::MDString::get(llvm_context, "llvm.loop.unroll.disable")));
+    } else if (name == "vectorize" && attribute.argument.value_or(2) > 1) {
+      operands.push_back(hint("llvm.loop.vectorize.enable",
+                              context.llvm_builder->getTrue()));
+      if (attribute.argument) {
+        operands.push_back(
+            hint("llvm.loop.vectorize.width", count(*attribute.argument)));
+      }
+    } else if ((name == "vectorize" || name == "novectorize") &&
+               attribute.argument.value_or(1) == 1) {
+      // A width of 1 is how LLVM spells "do not vectorize".
+      operands.push_back(hint("llvm.loop.vectorize.width", count(1)));
+    } else if (name == "interleave" && attribute.argument) {
+      operands.push_back(
+          hint("llvm.loop.interleave.count", count(*attribute.argument)));
+    } else {
+      throw std::runtime_error("Invalid loop attribute: @" + name);
+    }
+  }
+
+  llvm::MDNode* loop_id = llvm::MDNode::getDistinct(llvm_context, operands);
+  loop_id->replaceOperandWith(0, loop_id);
+  return loop_id;
+}
+
+WhileLoopNode::WhileLoopNode(ASTNode* cond, ASTNode* body)
+    : LoopNode(NodeKind::kWhileLoop), cond_(cond), body_(body) {}
+
+llvm::Value* WhileLoopNode::codegen(Context& context) {
+  Function* curr_func = context.llvm_builder->GetInsertBlock()->getParent();
+
+  BasicBlock* cond_block =
+      BasicBlock::Create(*context.llvm_context, "while.cond", curr_func);
+  BasicBlock* body_block =
+      BasicBlock::Create(*context.llvm_context, "while.body");
+  BasicBlock* exit_block =
+      BasicBlock::Create(*context.llvm_context, "while.end");
+
+  context.llvm_builder->CreateBr(cond_block);
+  context.llvm_builder->SetInsertPoint(cond_block);
+  llvm::Value* cond_val = cond_->codegen(context);
+  context.llvm_builder->CreateCondBr(cond_val, body_block, exit_block);
+
+  curr_func->insert(curr_func->end(), body_block);
+  context.llvm_builder->SetInsertPoint(body_block);
+  body_->codegen(context);
+  CreateLatch(context, cond_block);
+
+  curr_func->insert(curr_func->end(), exit_block);
+  context.llvm_builder->SetInsertPoint(exit_block);
+
+  return nullptr;
+}
+
+ForLoopNode::ForLoopNode(Identifier variable, ASTNode* begin, ASTNode* end,
+                         ASTNode* body)
+    : LoopNode(NodeKind::kForLoop),
+      variable_(variable),
+      begin_(begin),
+      end_(end),
+      body_(body) {}
+
+llvm::Value* ForLoopNode::codegen(Context& context) {
+  Function* curr_func = context.llvm_builder->GetInsertBlock()->getParent();
+  llvm::Type* i32_type = context.llvm_builder->getInt32Ty();
+
+  // The induction variable lives in an entry block alloca like any other
+  // local, so that mem2reg turns it into a PHI in the header.
+  llvm::IRBuilder<> tmp_builder(&curr_func->getEntryBlock(),
+                                curr_func->getEntryBlock().begin());
+  llvm::AllocaInst* alloca =
+      tmp_builder.CreateAlloca(i32_type, nullptr, variable_.name);
+
+  llvm::Value* begin_val = begin_->codegen(context);
+  begin_val = CastValue(context, begin_val, begin_val->getType(), i32_type);
+  llvm::Value* end_val = end_->codegen(context);
+  end_val = CastValue(context, end_val, end_val->getType(), i32_type);
+  context.llvm_builder->CreateStore(begin_val, alloca);
+
+  // The body cannot assign to the loop variable, so only the latch changes
+  // it.
+  context.symbol_table->AddScope();
+  context.symbol_table->AddSymbol(
+      variable_.id,
+      {nullptr, alloca, Type(PrimitiveType::kI32, IndirectionType::kNone),
+       true});
+
+  BasicBlock* cond_block =
+      BasicBlock::Create(*context.llvm_context, "for.cond", curr_func);
+  BasicBlock* body_block =
+      BasicBlock::Create(*context.llvm_context, "for.body");
+  BasicBlock* latch_block =
+      BasicBlock::Create(*context.llvm_context, "for.inc");
+  BasicBlock* exit_block =
+      BasicBlock::Create(*context.llvm_context, "for.end");
+
+  context.llvm_builder->CreateBr(cond_block);
+  context.llvm_builder->SetInsertPoint(cond_block);
+  llvm::Value* index =
+      context.llvm_builder->CreateLoad(i32_type, alloca, variable_.name);
+  llvm::Value* cond_val =
+      context.llvm_builder->CreateICmpSLT(index, end_val, "forcond");
+  context.llvm_builder->CreateCondBr(cond_val, body_block, exit_block);
+
+  curr_func->insert(curr_func->end(), body_block);
+  context.llvm_builder->SetInsertPoint(body_block);
+  body_->codegen(context);
+  context.llvm_builder->CreateBr(latch_block);
+
+  // The index is still below `end` here, so the increment cannot overflow.
+  curr_func->insert(curr_func->end(), latch_block);
+  context.llvm_builder->SetInsertPoint(latch_block);
+  index = context.llvm_builder->CreateLoad(i32_type, alloca, variable_.name);
+  llvm::Value* next = context.llvm_builder->CreateNSWAdd(
+      index, context.llvm_builder->getInt32(1), "fornext");
+  context.llvm_builder->CreateStore(next, alloca);
+  CreateLatch(context, cond_block);
+
+  context.symbol_table->RemoveScope();
+
+  curr_func->insert(curr_func->end(), exit_block);
+  context.llvm_builder->SetInsertPoint(exit_block);
+
+  return nullptr;
+}
+
+ArrayAccessNode::ArrayAccessNode(Identifier name, ASTNode* index)
+    : AssignableNode(NodeKind::kArrayAccess), name_(name), index_(index) {}
+
+llvm::Type* ArrayAccessNode::ElementType(Context& context) {
+  SymbolicValue& sym = context.symbol_table->GetSymbol(name_.id);
+  if (sym.type().aggregate_kind() == AggregateType::kSlice ||
+      IsPointer(sym.type()) || sym.type().is_soa()) {
+    return sym.type().element().llvm_type(context);
+  }
+  auto* array_type = llvm::dyn_cast<llvm::ArrayType>(sym.llvm_type(context));
+  if (array_type == nullptr) {
+    throw std::runtime_error("Only arrays, slices and pointers can be "
+                             "indexed");
+  }
+  return array_type->getElementType();
+}
+
+llvm::Value* ArrayAccessNode::CreateElementPointer(Context& context) {
+  SymbolicValue& sym = context.symbol_table->GetSymbol(name_.id);
+  llvm::Type* element_type = ElementType(context);
+  bool is_slice = sym.type().aggregate_kind() == AggregateType::kSlice;
+  llvm::Value* base = sym.llvm_alloca();
+  if (is_slice) {
+    base = LoadSlicePointer(context, base, name_.name);
+  } else if (IsPointer(sym.type())) {
+    base = context.llvm_builder->CreateLoad(
+        llvm::PointerType::get(*context.llvm_context, 0), base, name_.name);
+  }
+  llvm::Value* idx = CreateIndex(context);
+  return context.llvm_builder->CreateGEP(element_type, base, idx);
+}
+
+llvm::Value* ArrayAccessNode::CreateIndex(Context& context) {
+  SymbolicValue& sym = context.symbol_table->GetSymbol(name_.id);
   llvm::Value* idx = index_->codegen(context);
-  llvm::Value* ptr =
-      context.llvm_builder->CreateGEP(element_type, sym.llvm_alloca(), idx);
-  return context.llvm_builder->CreateLoad(element_type, ptr);
+  // Pointers do not know how many elements they point to, so only arrays
+  // and slices are checked.
+  if (context.bounds_check && !IsPointer(sym.type())) {
+    llvm::Value* length =
+        sym.type().aggregate_kind() == AggregateType::kSlice
+            ? LoadSliceLength(context, sym.llvm_alloca())
+            : context.llvm_builder->getInt32(sym.type().size());
+    CreateBoundsCheck(*context.llvm_builder, idx, length, false,
+                      context.bounds_trap, context.bounds_check_stats);
+  }
+  return idx;
+}
+
+llvm::Value* ArrayAccessNode::CreateFieldPointer(Context& context,
+                                                 llvm::Value* index,
+                                                 unsigned field) {
+  SymbolicValue& sym = context.symbol_table->GetSymbol(name_.id);
+  llvm::IRBuilder<>& builder = *context.llvm_builder;
+  return builder.CreateGEP(
+      sym.llvm_type(context), sym.llvm_alloca(),
+      {builder.getInt32(0), builder.getInt32(field), index});
+}
+
+bool ArrayAccessNode::is_soa_element(Context& context) {
+  return context.symbol_table->GetSymbol(name_.id).type().is_soa();
+}
+
+llvm::Value* ArrayAccessNode::soa_field_pointer(Context& context,
+                                                unsigned field) {
+  return CreateFieldPointer(context, CreateIndex(context), field);
+}
+
+llvm::Value* ArrayAccessNode::codegen(Context& context) {
+  if (is_soa_element(context)) {
+    llvm::Value* idx = CreateIndex(context);
+    const StructInfo* info =
+        context.symbol_table->GetSymbol(name_.id).type().struct_info();
+    llvm::Type* struct_type = ElementType(context);
+    llvm::Value* element = llvm::PoisonValue::get(struct_type);
+    for (unsigned i = 0; i < info->fields().size(); ++i) {
+      llvm::Value* field = context.llvm_builder->CreateLoad(
+          struct_type->getStructElementType(i),
+          CreateFieldPointer(context, idx, i));
+      element = context.llvm_builder->CreateInsertValue(element, field, i);
+    }
+    return element;
+  }
+  llvm::Value* ptr = CreateElementPointer(context);
+  return context.llvm_builder->CreateLoad(ElementType(context), ptr);
 }
 
 llvm::Value* ArrayAccessNode::llvm_alloca(Context& context) {
-  SymbolicValue& sym = context.symbol_table->GetSymbol(name_);
-  auto element_type =
-      llvm::cast<llvm::ArrayType>(sym.llvm_alloca()->getAllocatedType())
-          ->getElementType();
-  llvm::Value* idx = index_->codegen(context);
-  return context.llvm_builder->CreateGEP(element_type, sym.llvm_alloca(), idx);
+  if (is_soa_element(context)) {
+    throw std::runtime_error("The elements of " + std::string(name_.name) +
+                             " have no address, since it is a structure of "
+                             "arrays");
+  }
+  return CreateElementPointer(context);
 }
 
 Type ArrayAccessNode::type(Context& context) {
-  SymbolicValue& sym = context.symbol_table->GetSymbol(name_);
-  auto element_type =
-      llvm::cast<llvm::ArrayType>(sym.llvm_alloca()->getAllocatedType())
-          ->getElementType();
-  return Type(element_type);
+  llvm::Type* element_type = ElementType(context);
+  Type type = context.symbol_table->GetSymbol(name_.id).type();
+  // Structs cannot be told apart by their LLVM type alone.
+  return type.kind() == PrimitiveType::kStruct ? type.element()
+                                               : Type(element_type);
 }
 
 llvm::Value* ArrayAccessNode::assign(Context& context, llvm::Value* val) {
-  SymbolicValue& sym = context.symbol_table->GetSymbol(name_);
-  auto element_type =
-      llvm::cast<llvm::ArrayType>(sym.llvm_alloca()->getAllocatedType())
-          ->getElementType();
-  llvm::Value* idx = index_->codegen(context);
-  llvm::Value* ptr =
-      context.llvm_builder->CreateGEP(element_type, sym.llvm_alloca(), idx);
+  CheckAssignable(context.symbol_table->GetSymbol(name_.id), name_.name);
+  if (is_soa_element(context)) {
+    llvm::Type* struct_type = ElementType(context);
+    val = CastValue(context, val, val->getType(), struct_type);
+    llvm::Value* idx = CreateIndex(context);
+    unsigned num_fields = context.symbol_table->GetSymbol(name_.id)
+                              .type()
+                              .struct_info()
+                              ->fields()
+                              .size();
+    for (unsigned i = 0; i < num_fields; ++i) {
+      context.llvm_builder->CreateStore(
+          context.llvm_builder->CreateExtractValue(val, i),
+          CreateFieldPointer(context, idx, i));
+    }
+    return val;
+  }
+  llvm::Value* ptr = CreateElementPointer(context);
   return context.llvm_builder->CreateStore(val, ptr);
 }
 
+bool ArrayAccessNode::is_constant(Context& context) {
+  return context.symbol_table->GetSymbol(name_.id).is_constant();
+}
+
+FieldAccessNode::FieldAccessNode(AssignableNode* base, Identifier field)
+    : AssignableNode(NodeKind::kFieldAccess), base_(base), field_(field) {}
+
+const StructInfo* FieldAccessNode::BaseStruct(const Type& base_type) {
+  bool is_struct = base_type.aggregate_kind() == AggregateType::kSingular ||
+                   base_type.is_soa();
+  if (base_type.struct_info() == nullptr || !is_struct) {
+    throw std::runtime_error("Cannot access field " +
+                             std::string(field_.name) + " of a non-struct");
+  }
+  return base_type.struct_info();
+}
+
+llvm::Value* FieldAccessNode::codegen(Context& context) {
+  llvm::Type* field_type = type(context).llvm_type(context);
+  return context.llvm_builder->CreateLoad(field_type, llvm_alloca(context),
+                                          field_.name);
+}
+
+llvm::Value* FieldAccessNode::llvm_alloca(Context& context) {
+  Type base_type = base_->type(context);
+  const StructInfo* info = BaseStruct(base_type);
+  unsigned field = info->field_index(field_);
+
+  auto* element = llvm::dyn_cast<ArrayAccessNode>(base_);
+  if (element != nullptr && element->is_soa_element(context)) {
+    return element->soa_field_pointer(context, field);
+  }
+  if (base_type.is_soa()) {
+    return context.llvm_builder->CreateStructGEP(
+        base_type.llvm_type(context), base_->llvm_alloca(context), field,
+        field_.name);
+  }
+  llvm::Value* ptr = IsPointer(base_type) ? base_->codegen(context)
+                                          : base_->llvm_alloca(context);
+  return context.llvm_builder->CreateStructGEP(info->llvm_type(context), ptr,
+                                               field, field_.name);
+}
+
+Type FieldAccessNode::type(Context& context) {
+  Type base_type = base_->type(context);
+  const StructInfo* info = BaseStruct(base_type);
+  Type type = info->fields()[info->field_index(field_)].type;
+  if (!base_type.is_soa()) {
+    return type;
+  }
+  // Only arrays of primitive types can be named, so the arrays of other
+  // fields are only accessed through elements.
+  if (type.kind() == PrimitiveType::kStruct ||
+      type.indirection() != IndirectionType::kNone) {
+    throw std::runtime_error("Field " + std::string(field_.name) +
+                             " of a structure of arrays can only be "
+                             "accessed through its elements");
+  }
+  return Type(type.kind(), base_type.size(), IndirectionType::kNone);
+}
+
+llvm::Value* FieldAccessNode::assign(Context& context, llvm::Value* val) {
+  if (is_constant(context)) {
+    throw std::runtime_error("Cannot assign to field " +
+                             std::string(field_.name) + " of a constant");
+  }
+  llvm::Type* field_type = type(context).llvm_type(context);
+  return AssignValue(context, val, llvm_alloca(context), field_type);
+}
+
+bool FieldAccessNode::is_constant(Context& context) {
+  // Through a pointer, the field is not part of the base.
+  return !IsPointer(base_->type(context)) && base_->is_constant(context);
+}
+
+SliceNode::SliceNode(Identifier name, ASTNode* begin, ASTNode* end)
+    : ASTNode(NodeKind::kSlice), name_(name), begin_(begin), end_(end) {}
+
+llvm::Value* SliceNode::codegen(Context& context) {
+  SymbolicValue& sym = context.symbol_table->GetSymbol(name_.id);
+  Type type = sym.type();
+  if (type.is_soa()) {
+    throw std::runtime_error("A structure of arrays cannot be sliced");
+  }
+  llvm::Type* element_type = type.element().llvm_type(context);
+  llvm::Type* i32_type = context.llvm_builder->getInt32Ty();
+
+  // The number of elements of `name`, only needed for bounds checks.
+  llvm::Value* base;
+  llvm::Value* size = nullptr;
+  switch (type.aggregate_kind()) {
+    case AggregateType::kArray:
+      base = sym.llvm_alloca();
+      if (context.bounds_check) {
+        size = context.llvm_builder->getInt32(type.size());
+      }
+      break;
+    case AggregateType::kSlice:
+      base = LoadSlicePointer(context, sym.llvm_alloca(), name_.name);
+      if (context.bounds_check) {
+        size = LoadSliceLength(context, sym.llvm_alloca());
+      }
+      break;
+    default:
+      throw std::runtime_error("Only arrays and slices can be sliced");
+  }
+
+  llvm::Value* begin = begin_->codegen(context);
+  begin = CastValue(context, begin, begin->getType(), i32_type);
+  llvm::Value* end = end_->codegen(context);
+  end = CastValue(context, end, end->getType(), i32_type);
+  // A slice may be empty, or end right after the last element.
+  if (context.bounds_check) {
+    CreateBoundsCheck(*context.llvm_builder, end, size, true,
+                      context.bounds_trap, context.bounds_check_stats);
+    CreateBoundsCheck(*context.llvm_builder, begin, end, true,
+                      context.bounds_trap, context.bounds_check_stats);
+  }
+
+  llvm::Value* ptr = context.llvm_builder->CreateGEP(element_type, base, begin);
+  llvm::Value* length = context.llvm_builder->CreateSub(end, begin, "len");
+  return CreateSlice(context, ptr, length);
+}
+
 MultiAssignmentNode::MultiAssignmentNode(AssignableNode* destination,
                                          ASTAggregateNode* values)
-    : destination_(dynamic_cast<MultiAssignableNode*>(destination)),
-      values_(values) {}
+    : ASTNode(NodeKind::kMultiAssignment),
+      destination_(llvm::dyn_cast<MultiAssignableNode>(destination)),
+      values_(values) {
+  if (destination_ == nullptr) {
+    throw std::runtime_error("Only variables can be multi-assigned");
+  }
+}
 
 llvm::Value* MultiAssignmentNode::codegen(Context& context) {
   return destination_->multi_assign(context,
@@ -431,33 +1608,14 @@ llvm::Value* MultiAssignmentNode::codegen(Context& context) {
 }
 
 llvm::Value* StringLiteralNode::codegen(Context& context) {
-  return llvm::ConstantDataArray::getString(context.llvm_context, value_, true);
-}
-
-void VariableListNode::push_back(ASTNode* node) {
-  AssignableNode* assignable = dynamic_cast<AssignableNode*>(node);
-  if (assignable == nullptr) {
-    throw std::runtime_error(
-        "VariableListNode can only contain assignable nodes");
-  }
-
-  nodes_.emplace_back(assignable);
+  return llvm::ConstantDataArray::getString(*context.llvm_context, value_,
+                                           true);
 }
 
 llvm::Value* VariableListNode::codegen(Context& context) {
   throw std::runtime_error("VariableListNode cannot be used as an expression");
 }
 
-std::vector<llvm::Value*> VariableListNode::codegen_aggregate(
-    Context& context) {
-  std::vector<llvm::Value*> vals;
-  vals.reserve(nodes_.size());
-  for (auto& node : nodes_) {
-    vals.push_back(node->codegen(context));
-  }
-  return vals;
-}
-
 llvm::Value* VariableListNode::assign(Context& context, llvm::Value* value) {
   for (auto& node : nodes_) {
     node->assign(context, value);
@@ -487,57 +1645,43 @@ llvm::Value* VariableListNode::multi_assign(Context& context,
   return nullptr;
 }
 
-GetAddressNode::GetAddressNode(ASTNode* node) : node_(node) {
-  if (dynamic_cast<AssignableNode*>(node) == nullptr) {
-    throw std::runtime_error("GetAddressNode can only take assignable nodes");
-  }
-}
+GetAddressNode::GetAddressNode(AssignableNode* node)
+    : ASTNode(NodeKind::kGetAddress), node_(node) {}
 
 llvm::Value* GetAddressNode::codegen(Context& context) {
-  return dynamic_cast<AssignableNode*>(node_.get())->llvm_alloca(context);
+  return node_->llvm_alloca(context);
 }
 
-DereferenceNode::DereferenceNode(ASTNode* node) : node_(node) {
-  if (dynamic_cast<AssignableNode*>(node) == nullptr) {
-    throw std::runtime_error("DereferenceNode can only take assignable nodes");
-  }
-}
+DereferenceNode::DereferenceNode(AssignableNode* node)
+    : AssignableNode(NodeKind::kDereference), node_(node) {}
 
 llvm::Value* DereferenceNode::codegen(Context& context) {
-  AssignableNode* assignable = dynamic_cast<AssignableNode*>(node_.get());
-  llvm::Value* ptr_ptr = assignable->llvm_alloca(context);
-  llvm::Value* ptr = context.llvm_builder->CreateLoad(
-      llvm::PointerType::get(context.llvm_context, 0), ptr_ptr);
-  Type type = assignable->type(context);
-  if (type.indirection() != IndirectionType::kPointer) {
-    throw std::runtime_error("Cannot dereference non-pointer type");
-  }
-  Type pointee_type = Type(type.kind(), IndirectionType::kNone);
-  return context.llvm_builder->CreateLoad(pointee_type.llvm_type(context), ptr);
+  return context.llvm_builder->CreateLoad(type(context).llvm_type(context),
+                                          llvm_alloca(context));
 }
 
 llvm::Value* DereferenceNode::llvm_alloca(Context& context) {
-  return codegen(context);
+  // The pointee lives wherever the pointer variable points to.
+  Type type = node_->type(context);
+  if (type.indirection() != IndirectionType::kPointer) {
+    throw std::runtime_error("Cannot dereference non-pointer type");
+  }
+  return context.llvm_builder->CreateLoad(
+      llvm::PointerType::get(*context.llvm_context, 0),
+      node_->llvm_alloca(context));
 }
 
 Type DereferenceNode::type(Context& context) {
-  AssignableNode* assignable = dynamic_cast<AssignableNode*>(node_.get());
-  Type type = assignable->type(context);
+  Type type = node_->type(context);
   if (type.indirection() != IndirectionType::kPointer) {
     throw std::runtime_error("Cannot dereference non-pointer type");
   }
-  return Type(type.kind(), IndirectionType::kNone);
+  return type.element();
 }
 
 llvm::Value* DereferenceNode::assign(Context& context, llvm::Value* value) {
-  AssignableNode* assignable = dynamic_cast<AssignableNode*>(node_.get());
-  llvm::Value* ptr = assignable->llvm_alloca(context);
-  Type type = assignable->type(context);
-  if (type.indirection() != IndirectionType::kPointer) {
-    throw std::runtime_error("Cannot dereference non-pointer type");
-  }
-  Type pointee_type = Type(type.kind(), IndirectionType::kNone);
-  return AssignValue(context, value, ptr, pointee_type.llvm_type(context));
+  return AssignValue(context, value, llvm_alloca(context),
+                     type(context).llvm_type(context));
 }
 
 }  // namespace chovl
@@ -0,0 +1,68 @@
+#include "bounds_check.h"
+
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Intrinsics.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace chovl {
+
+void CreateBoundsCheck(llvm::IRBuilder<>& builder, llvm::Value* index,
+                       llvm::Value* length, bool inclusive,
+                       llvm::BasicBlock*& trap_block,
+                       BoundsCheckStats& stats) {
+  // Narrower indices, i.e. chars, are sign-extended like in a GEP.
+  index = builder.CreateSExtOrTrunc(index, length->getType());
+  llvm::Value* in_bounds =
+      inclusive ? builder.CreateICmpULE(index, length, "inbounds")
+                : builder.CreateICmpULT(index, length, "inbounds");
+
+  if (auto* constant = llvm::dyn_cast<llvm::ConstantInt>(in_bounds)) {
+    if (constant->isZero()) {
+      int64_t value = llvm::cast<llvm::ConstantInt>(index)->getSExtValue();
+      int64_t limit = llvm::cast<llvm::ConstantInt>(length)->getSExtValue();
+      throw std::runtime_error("Index " + std::to_string(value) +
+                               " is out of bounds for a length of " +
+                               std::to_string(limit));
+    }
+    ++stats.elided;
+    return;
+  }
+  ++stats.emitted;
+
+  llvm::Function* function = builder.GetInsertBlock()->getParent();
+  llvm::LLVMContext& context = builder.getContext();
+  if (trap_block == nullptr) {
+    trap_block = llvm::BasicBlock::Create(context, "bounds.trap");
+    llvm::IRBuilder<> trap_builder(trap_block);
+    trap_builder.CreateCall(llvm::Intrinsic::getDeclaration(
+        function->getParent(), llvm::Intrinsic::trap));
+    trap_builder.CreateUnreachable();
+  }
+
+  llvm::Value* expected = builder.CreateIntrinsic(
+      llvm::Intrinsic::expect, {in_bounds->getType()},
+      {in_bounds, builder.getTrue()});
+  llvm::BasicBlock* ok_block =
+      llvm::BasicBlock::Create(context, "bounds.ok", function);
+  builder.CreateCondBr(expected, ok_block, trap_block);
+  builder.SetInsertPoint(ok_block);
+}
+
+unsigned CountBoundsChecks(const llvm::Module& module) {
+  const llvm::Function* trap =
+      module.getFunction(llvm::Intrinsic::getName(llvm::Intrinsic::trap));
+  if (trap == nullptr) {
+    return 0;
+  }
+  unsigned checks = 0;
+  for (const llvm::User* user : trap->users()) {
+    if (auto* call = llvm::dyn_cast<llvm::CallInst>(user)) {
+      checks += llvm::pred_size(call->getParent());
+    }
+  }
+  return checks;
+}
+
+}  // namespace chovl
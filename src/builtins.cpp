@@ -0,0 +1,114 @@
+#include "builtins.h"
+
+#include <stdexcept>
+#include <string>
+
+#include "scope.h"
+
+namespace chovl {
+namespace {
+llvm::FixedVectorType* GetVectorArgument(std::string_view name,
+                                         const std::vector<llvm::Value*>& args,
+                                         size_t num_args) {
+  if (args.size() != num_args) {
+    throw std::runtime_error(std::string(name) + " expects " +
+                             std::to_string(num_args) + " arguments");
+  }
+  auto* type = llvm::dyn_cast<llvm::FixedVectorType>(args[0]->getType());
+  if (type == nullptr) {
+    throw std::runtime_error("The first argument of " + std::string(name) +
+                             " must be a vector");
+  }
+  return type;
+}
+
+llvm::Value* GetLane(std::string_view name, llvm::Value* lane) {
+  if (!lane->getType()->isIntegerTy()) {
+    throw std::runtime_error("The lane of " + std::string(name) +
+                             " must be an integer");
+  }
+  return lane;
+}
+}  // namespace
+
+llvm::Value* CreateBuiltinCall(llvm::IRBuilder<>* builder,
+                               std::string_view name,
+                               const std::vector<llvm::Value*>& args) {
+  if (name == "len") {
+    if (args.size() != 1) {
+      throw std::runtime_error("len expects 1 argument");
+    }
+    llvm::Type* type = args[0]->getType();
+    if (type == GetSliceType(builder->getContext())) {
+      return builder->CreateExtractValue(args[0], 1, "len");
+    }
+    if (type->isArrayTy()) {
+      return builder->getInt32(type->getArrayNumElements());
+    }
+    // A structure of arrays has the length of its arrays.
+    auto* struct_type = llvm::dyn_cast<llvm::StructType>(type);
+    if (struct_type != nullptr && struct_type->isLiteral() &&
+        struct_type->getNumElements() != 0 &&
+        struct_type->getElementType(0)->isArrayTy()) {
+      return builder->getInt32(
+          struct_type->getElementType(0)->getArrayNumElements());
+    }
+    throw std::runtime_error("len expects a slice or an array");
+  }
+
+  if (name == "extract") {
+    GetVectorArgument(name, args, 2);
+    return builder->CreateExtractElement(args[0], GetLane(name, args[1]),
+                                         "lane");
+  }
+
+  if (name == "insert") {
+    llvm::FixedVectorType* type = GetVectorArgument(name, args, 3);
+    if (args[2]->getType() != type->getElementType()) {
+      throw std::runtime_error("The value inserted into a vector must have "
+                               "the type of its lanes");
+    }
+    return builder->CreateInsertElement(
+        args[0], args[2], GetLane(name, args[1]), "insert");
+  }
+
+  bool is_reduction = name == "reduce_add" || name == "reduce_mul" ||
+                      name == "reduce_min" || name == "reduce_max";
+  if (!is_reduction) {
+    return nullptr;
+  }
+
+  llvm::FixedVectorType* type = GetVectorArgument(name, args, 1);
+  llvm::Value* vector = args[0];
+  bool is_float = type->getElementType()->isFloatingPointTy();
+  llvm::CallInst* result;
+  if (name == "reduce_add") {
+    result = is_float ? builder->CreateFAddReduce(
+                            llvm::ConstantFP::getNegativeZero(
+                                type->getElementType()),
+                            vector)
+                      : builder->CreateAddReduce(vector);
+  } else if (name == "reduce_mul") {
+    result = is_float ? builder->CreateFMulReduce(
+                            llvm::ConstantFP::get(type->getElementType(), 1.0),
+                            vector)
+                      : builder->CreateMulReduce(vector);
+  } else if (name == "reduce_min") {
+    result = is_float ? builder->CreateFPMinReduce(vector)
+                      : builder->CreateIntMinReduce(vector, /*IsSigned=*/true);
+  } else {
+    result = is_float ? builder->CreateFPMaxReduce(vector)
+                      : builder->CreateIntMaxReduce(vector, /*IsSigned=*/true);
+  }
+
+  // Floating-point sums and products are otherwise computed lane by lane in
+  // order, which defeats the purpose of reducing a vector.
+  if (is_float && (name == "reduce_add" || name == "reduce_mul")) {
+    llvm::FastMathFlags flags;
+    flags.setAllowReassoc();
+    result->setFastMathFlags(flags);
+  }
+  return result;
+}
+
+}  // namespace chovl
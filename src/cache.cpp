@@ -0,0 +1,140 @@
+#include "cache.h"
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+#include <stdexcept>
+
+namespace chovl {
+namespace {
+// Bump this whenever the code generator changes in a way that is not visible
+// in the unoptimized IR, e.g. the optimization pipeline.
+constexpr char kCacheVersion[] = "chovl-cache-1";
+
+// Clones the definition of `func` into its own module. Every other function
+// becomes a declaration and unreferenced declarations are dropped, so that
+// the module only depends on what `func` actually uses.
+std::unique_ptr<llvm::Module> ExtractFunction(const llvm::Module& module,
+                                              const llvm::Function& func) {
+  llvm::ValueToValueMapTy value_map;
+  std::unique_ptr<llvm::Module> extracted = llvm::CloneModule(
+      module, value_map, [&](const llvm::GlobalValue* global) {
+        return global == &func || (llvm::isa<llvm::GlobalVariable>(global) &&
+                                   global->hasLocalLinkage());
+      });
+
+  for (auto& other : llvm::make_early_inc_range(extracted->functions())) {
+    if (other.isDeclaration() && other.use_empty()) {
+      other.eraseFromParent();
+    }
+  }
+  for (auto& global : llvm::make_early_inc_range(extracted->globals())) {
+    if (global.use_empty()) {
+      global.eraseFromParent();
+    }
+  }
+  return extracted;
+}
+
+// Clones everything but the function definitions, i.e. the declarations and
+// the globals that are visible outside of the module.
+std::unique_ptr<llvm::Module> ExtractSkeleton(const llvm::Module& module) {
+  llvm::ValueToValueMapTy value_map;
+  return llvm::CloneModule(
+      module, value_map, [](const llvm::GlobalValue* global) {
+        return llvm::isa<llvm::GlobalVariable>(global) &&
+               !global->hasLocalLinkage();
+      });
+}
+
+std::string ComputeKey(const llvm::Module& extracted,
+                       OptimizationLevel level) {
+  llvm::SmallVector<char, 0> bitcode;
+  llvm::raw_svector_ostream out(bitcode);
+  llvm::WriteBitcodeToFile(extracted, out);
+
+  llvm::SHA256 hasher;
+  hasher.update(kCacheVersion);
+  hasher.update(std::to_string(static_cast<int>(level)));
+  hasher.update(llvm::StringRef(bitcode.data(), bitcode.size()));
+  return llvm::toHex(hasher.final(), /*LowerCase=*/true);
+}
+
+std::unique_ptr<llvm::Module> LoadEntry(const std::string& path,
+                                        llvm::LLVMContext& llvm_context) {
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer =
+      llvm::MemoryBuffer::getFile(path);
+  if (!buffer) {
+    return nullptr;
+  }
+  llvm::Expected<std::unique_ptr<llvm::Module>> module =
+      llvm::parseBitcodeFile((*buffer)->getMemBufferRef(), llvm_context);
+  if (!module) {
+    // A corrupt entry is treated like a missing one and gets overwritten.
+    llvm::consumeError(module.takeError());
+    return nullptr;
+  }
+  return std::move(*module);
+}
+
+// Writes to a temporary file first, so that concurrent compilations never
+// observe a partially written entry.
+void StoreEntry(const std::string& path, const llvm::Module& module) {
+  int fd;
+  llvm::SmallString<128> tmp_path;
+  if (llvm::sys::fs::createUniqueFile(path + ".%%%%%%.tmp", fd, tmp_path)) {
+    return;
+  }
+  {
+    llvm::raw_fd_ostream out(fd, /*shouldClose=*/true);
+    llvm::WriteBitcodeToFile(module, out);
+  }
+  if (llvm::sys::fs::rename(tmp_path, path)) {
+    llvm::sys::fs::remove(tmp_path);
+  }
+}
+}  // namespace
+
+std::unique_ptr<llvm::Module> OptimizeModuleCached(
+    std::unique_ptr<llvm::Module> module, OptimizationLevel level,
+    llvm::TargetMachine* target_machine, const std::string& cache_dir,
+    TimeReport* time_report) {
+  if (llvm::sys::fs::create_directories(cache_dir)) {
+    throw std::runtime_error("Could not create cache directory: " + cache_dir);
+  }
+
+  std::unique_ptr<llvm::Module> result = ExtractSkeleton(*module);
+  llvm::Linker linker(*result);
+  for (const auto& func : *module) {
+    if (func.isDeclaration()) {
+      continue;
+    }
+
+    std::unique_ptr<llvm::Module> extracted = ExtractFunction(*module, func);
+    llvm::SmallString<128> path(cache_dir);
+    llvm::sys::path::append(path, ComputeKey(*extracted, level) + ".bc");
+
+    std::unique_ptr<llvm::Module> optimized =
+        LoadEntry(std::string(path), module->getContext());
+    if (optimized == nullptr) {
+      OptimizeModule(*extracted, level, target_machine, time_report);
+      StoreEntry(std::string(path), *extracted);
+      optimized = std::move(extracted);
+    }
+
+    if (linker.linkInModule(std::move(optimized))) {
+      throw std::runtime_error("Could not link function " +
+                               std::string(func.getName()));
+    }
+  }
+  return result;
+}
+
+}  // namespace chovl
@@ -0,0 +1,498 @@
+#include "driver.h"
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/TimeProfiler.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "ast.h"
+#include "bounds_check.h"
+#include "cache.h"
+#include "emitter.h"
+#include "frontend.h"
+#include "jit.h"
+#include "target.h"
+#include "timing.h"
+
+namespace chovl {
+namespace {
+// A linked module together with the context that owns it.
+struct Program {
+  std::unique_ptr<llvm::LLVMContext> llvm_context;
+  std::unique_ptr<llvm::Module> llvm_module;
+};
+
+// The result of compiling a single input file on a worker thread. Modules can
+// only be linked if they live in the same LLVMContext, so every unit but a
+// lone one is handed back as bitcode and read into the program's context.
+struct CompiledUnit {
+  std::unique_ptr<AST> ast;
+  llvm::SmallVector<char, 0> bitcode;
+  std::string error;
+  BoundsCheckStats bounds_check_stats;
+};
+
+bool ParseOptimizationLevel(const std::string& arg, OptimizationLevel& level) {
+  if (arg == "-O0") {
+    level = OptimizationLevel::kO0;
+  } else if (arg == "-O1") {
+    level = OptimizationLevel::kO1;
+  } else if (arg == "-O2") {
+    level = OptimizationLevel::kO2;
+  } else if (arg == "-O3") {
+    level = OptimizationLevel::kO3;
+  } else if (arg == "-Os") {
+    level = OptimizationLevel::kOs;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseOutputKind(const std::string& arg, OutputKind& kind) {
+  if (arg == "--emit=ll") {
+    kind = OutputKind::kIR;
+  } else if (arg == "--emit=bc") {
+    kind = OutputKind::kBitcode;
+  } else if (arg == "--emit=asm" || arg == "-S") {
+    kind = OutputKind::kAssembly;
+  } else if (arg == "--emit=obj" || arg == "-c") {
+    kind = OutputKind::kObject;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseLexerKind(const std::string& arg, LexerKind& lexer) {
+  if (arg == "--lexer=flex") {
+    lexer = LexerKind::kFlex;
+  } else if (arg == "--lexer=fast") {
+    lexer = LexerKind::kFast;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool ParseTailCallMode(const std::string& arg, TailCallMode& mode) {
+  if (arg == "-ftail-calls=none") {
+    mode = TailCallMode::kNone;
+  } else if (arg == "-ftail-calls=auto") {
+    mode = TailCallMode::kAuto;
+  } else if (arg == "-ftail-calls=guaranteed") {
+    mode = TailCallMode::kGuaranteed;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+unsigned ParseJobs(const std::string& value) {
+  try {
+    int jobs = std::stoi(value);
+    if (jobs > 0) {
+      return jobs;
+    }
+  } catch (std::exception&) {
+  }
+  throw std::runtime_error("Invalid number of jobs: " + value);
+}
+
+unsigned ParseGranularity(const std::string& value) {
+  try {
+    int granularity = std::stoi(value);
+    if (granularity >= 0) {
+      return granularity;
+    }
+  } catch (std::exception&) {
+  }
+  throw std::runtime_error("Invalid time trace granularity: " + value);
+}
+
+// Like clang, -fprofile-generate and -fprofile-use take a directory, in which
+// the profile has a default name, or for the latter also the profile itself.
+std::string ProfileGenerateFile(const std::string& dir) {
+  llvm::SmallString<128> path(dir);
+  llvm::sys::path::append(path, "default.profraw");
+  return std::string(path);
+}
+
+std::string ProfileUseFile(const std::string& path) {
+  llvm::SmallString<128> file(path);
+  if (llvm::sys::fs::is_directory(file)) {
+    llvm::sys::path::append(file, "default.profdata");
+  }
+  if (!llvm::sys::fs::exists(file)) {
+    throw std::runtime_error("Profile not found: " + std::string(file));
+  }
+  return std::string(file);
+}
+
+std::string DefaultOutputFile(OutputKind kind) {
+  switch (kind) {
+    case OutputKind::kIR:
+      return "a.ll";
+    case OutputKind::kBitcode:
+      return "a.bc";
+    case OutputKind::kAssembly:
+      return "a.s";
+    case OutputKind::kObject:
+      return "a.o";
+  }
+  return "a.out";
+}
+
+bool IsTiming(const DriverOptions& options) {
+  return options.time_report || !options.time_trace_file.empty();
+}
+
+std::unique_ptr<AST> CompileFile(const std::string& path,
+                                 const DriverOptions& options,
+                                 TimeReport* time_report) {
+  // Neither lexer needs a terminating null byte, which lets large files be
+  // mapped instead of copied.
+  llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> source =
+      llvm::MemoryBuffer::getFile(path, /*IsText=*/false,
+                                  /*RequiresNullTerminator=*/false);
+  if (!source) {
+    throw std::runtime_error("Could not open input file");
+  }
+
+  // The parser pulls tokens from the lexer as it goes, so lexing is only
+  // timed on its own by an extra pass over the input.
+  if (IsTiming(options)) {
+    PhaseScope scope(time_report, "Lex", path);
+    Tokenize((*source)->getBuffer(), options.lexer);
+  }
+
+  std::unique_ptr<AST> ast;
+  {
+    PhaseScope scope(time_report, "Parse", path);
+    ast = Parse((*source)->getBuffer(), options.lexer);
+  }
+  Context& context = ast->context();
+  context.time_report = time_report;
+  context.tail_call_mode = options.tail_calls;
+  context.bounds_check = options.bounds_check;
+
+  // TargetMachine is not thread-safe, so every unit gets its own. Even IR
+  // output is generated for the target, so that the optimizer knows the data
+  // layout and the processor's features.
+  std::unique_ptr<llvm::TargetMachine> target_machine =
+      CreateTargetMachine(options.opt_level, options.target);
+  ConfigureModule(*context.llvm_module, *target_machine);
+
+  {
+    PhaseScope scope(time_report, "Codegen", path);
+    ast->codegen();
+  }
+  SetTargetAttributes(*context.llvm_module, *target_machine);
+  // Functions are optimized one by one in the cache, which would give every
+  // one of them its own copy of the profile's globals, and profiles are not
+  // part of the cache key.
+  if (options.lto) {
+    OptimizeModuleForLTO(*context.llvm_module, options.opt_level,
+                         target_machine.get(), time_report, options.profile);
+  } else if (options.cache_dir.empty() || options.profile.enabled()) {
+    OptimizeModule(*context.llvm_module, options.opt_level,
+                   target_machine.get(), time_report, options.profile);
+  } else {
+    context.llvm_module = OptimizeModuleCached(
+        std::move(context.llvm_module), options.opt_level,
+        target_machine.get(), options.cache_dir, time_report);
+  }
+  if (options.bounds_check) {
+    context.bounds_check_stats.remaining =
+        CountBoundsChecks(*context.llvm_module);
+  }
+  context.time_report = nullptr;
+  return ast;
+}
+
+std::vector<CompiledUnit> CompileFiles(const DriverOptions& options,
+                                       TimeReport* time_report) {
+  std::vector<CompiledUnit> units(options.input_files.size());
+  std::atomic<size_t> next_unit = 0;
+
+  auto worker = [&]() {
+    for (size_t i = next_unit++; i < units.size(); i = next_unit++) {
+      const std::string& path = options.input_files[i];
+      try {
+        std::unique_ptr<AST> ast = CompileFile(path, options, time_report);
+        units[i].bounds_check_stats = ast->context().bounds_check_stats;
+        if (units.size() == 1) {
+          units[i].ast = std::move(ast);
+        } else {
+          llvm::raw_svector_ostream out(units[i].bitcode);
+          llvm::WriteBitcodeToFile(*ast->context().llvm_module, out);
+        }
+      } catch (std::exception& e) {
+        units[i].error = path + ": " + e.what();
+      }
+    }
+  };
+
+  size_t num_threads = std::min<size_t>(options.jobs, units.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back([&]() {
+      // The time trace profiler keeps a separate trace for every thread,
+      // which is merged into the main thread's when it finishes.
+      if (!options.time_trace_file.empty()) {
+        llvm::timeTraceProfilerInitialize(options.time_trace_granularity,
+                                          "chovl");
+      }
+      worker();
+      if (!options.time_trace_file.empty()) {
+        llvm::timeTraceProfilerFinishThread();
+      }
+    });
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return units;
+}
+
+Program LinkUnits(std::vector<CompiledUnit>& units,
+                  const DriverOptions& options) {
+  Program program;
+  if (units.size() == 1) {
+    Context& context = units[0].ast->context();
+    program.llvm_context = std::move(context.llvm_context);
+    program.llvm_module = std::move(context.llvm_module);
+    units[0].ast.reset();
+    return program;
+  }
+
+  program.llvm_context = std::make_unique<llvm::LLVMContext>();
+  program.llvm_module =
+      std::make_unique<llvm::Module>("chovl", *program.llvm_context);
+  llvm::Linker linker(*program.llvm_module);
+  for (size_t i = 0; i < units.size(); ++i) {
+    const std::string& path = options.input_files[i];
+    llvm::MemoryBufferRef buffer(
+        llvm::StringRef(units[i].bitcode.data(), units[i].bitcode.size()),
+        path);
+    llvm::Expected<std::unique_ptr<llvm::Module>> module =
+        llvm::parseBitcodeFile(buffer, *program.llvm_context);
+    if (!module) {
+      throw std::runtime_error(path + ": " +
+                               llvm::toString(module.takeError()));
+    }
+    if (linker.linkInModule(std::move(*module))) {
+      throw std::runtime_error(path + ": could not be linked");
+    }
+    units[i].bitcode.clear();
+  }
+  return program;
+}
+
+void EmitProgram(Program& program, const DriverOptions& options) {
+  switch (options.output_kind) {
+    case OutputKind::kIR:
+      EmitIRFile(*program.llvm_module, options.output_file);
+      break;
+    case OutputKind::kBitcode:
+      EmitBitcodeFile(*program.llvm_module, options.output_file);
+      break;
+    case OutputKind::kAssembly:
+      EmitNativeFile(*program.llvm_module,
+                     *CreateTargetMachine(options.opt_level, options.target),
+                     options.output_file, llvm::CodeGenFileType::AssemblyFile);
+      break;
+    case OutputKind::kObject:
+      EmitNativeFile(*program.llvm_module,
+                     *CreateTargetMachine(options.opt_level, options.target),
+                     options.output_file, llvm::CodeGenFileType::ObjectFile);
+      break;
+  }
+}
+
+int CompileProgram(const DriverOptions& options, TimeReport* time_report) {
+  std::vector<CompiledUnit> units = CompileFiles(options, time_report);
+  bool has_errors = false;
+  for (auto& unit : units) {
+    if (!unit.error.empty()) {
+      std::cerr << unit.error << '\n';
+      has_errors = true;
+    }
+  }
+  if (has_errors) {
+    return 1;
+  }
+  BoundsCheckStats bounds_check_stats;
+  for (auto& unit : units) {
+    bounds_check_stats += unit.bounds_check_stats;
+  }
+
+  Program program;
+  {
+    PhaseScope scope(time_report, "Link");
+    program = LinkUnits(units, options);
+  }
+  if (options.lto) {
+    std::unique_ptr<llvm::TargetMachine> target_machine =
+        CreateTargetMachine(options.opt_level, options.target);
+    OptimizeProgram(*program.llvm_module, options.opt_level,
+                    target_machine.get(), options.exports, time_report,
+                    options.profile);
+    if (options.bounds_check) {
+      bounds_check_stats.remaining = CountBoundsChecks(*program.llvm_module);
+    }
+  }
+  if (options.bounds_check_report) {
+    std::cerr << "Bounds checks: " << bounds_check_stats.elided
+              << " elided statically, " << bounds_check_stats.emitted
+              << " emitted, " << bounds_check_stats.remaining
+              << " left after optimization\n";
+  }
+  if (options.run) {
+    return RunModule(std::move(program.llvm_module),
+                     std::move(program.llvm_context));
+  }
+
+  PhaseScope scope(time_report, "Emit", options.output_file);
+  EmitProgram(program, options);
+  return 0;
+}
+}  // namespace
+
+DriverOptions ParseArguments(int argc, char** argv) {
+  DriverOptions options;
+  bool time_trace = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-o" && i + 1 < argc) {
+      options.output_file = argv[++i];
+    } else if (arg == "-j" && i + 1 < argc) {
+      options.jobs = ParseJobs(argv[++i]);
+    } else if (arg.starts_with("-j")) {
+      options.jobs = ParseJobs(arg.substr(2));
+    } else if (ParseOptimizationLevel(arg, options.opt_level)) {
+      continue;
+    } else if (ParseOutputKind(arg, options.output_kind)) {
+      continue;
+    } else if (ParseLexerKind(arg, options.lexer)) {
+      continue;
+    } else if (ParseTailCallMode(arg, options.tail_calls)) {
+      continue;
+    } else if (arg.starts_with("-march=")) {
+      options.target.cpu = arg.substr(std::string("-march=").size());
+    } else if (arg.starts_with("-mcpu=")) {
+      options.target.cpu = arg.substr(std::string("-mcpu=").size());
+    } else if (arg.starts_with("-mattr=")) {
+      options.target.features = arg.substr(std::string("-mattr=").size());
+    } else if (arg == "-fbounds-check") {
+      options.bounds_check = true;
+    } else if (arg == "-fbounds-check-report") {
+      options.bounds_check = true;
+      options.bounds_check_report = true;
+    } else if (arg == "-fprofile-generate") {
+      options.profile.generate_file = ProfileGenerateFile("");
+    } else if (arg.starts_with("-fprofile-generate=")) {
+      options.profile.generate_file = ProfileGenerateFile(
+          arg.substr(std::string("-fprofile-generate=").size()));
+    } else if (arg.starts_with("-fprofile-use=")) {
+      options.profile.use_file =
+          ProfileUseFile(arg.substr(std::string("-fprofile-use=").size()));
+    } else if (arg == "--lto") {
+      options.lto = true;
+    } else if (arg.starts_with("--export=")) {
+      llvm::StringRef list(arg);
+      llvm::SmallVector<llvm::StringRef, 4> names;
+      list.drop_front(std::string("--export=").size())
+          .split(names, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+      for (llvm::StringRef name : names) {
+        options.exports.push_back(name.str());
+      }
+    } else if (arg == "--run") {
+      options.run = true;
+    } else if (arg.starts_with("--cache-dir=")) {
+      options.cache_dir = arg.substr(std::string("--cache-dir=").size());
+    } else if (arg == "-ftime-report") {
+      options.time_report = true;
+    } else if (arg == "-ftime-trace") {
+      time_trace = true;
+    } else if (arg.starts_with("-ftime-trace=")) {
+      options.time_trace_file = arg.substr(std::string("-ftime-trace=").size());
+      time_trace = true;
+    } else if (arg.starts_with("-ftime-trace-granularity=")) {
+      options.time_trace_granularity = ParseGranularity(
+          arg.substr(std::string("-ftime-trace-granularity=").size()));
+    } else if (!arg.empty() && arg[0] != '-') {
+      options.input_files.push_back(arg);
+    } else {
+      throw std::runtime_error("Invalid argument: " + arg);
+    }
+  }
+
+  if (options.input_files.empty()) {
+    throw std::runtime_error("No input file");
+  }
+  if (!options.profile.generate_file.empty()) {
+    // The JIT does not provide the sections the counters are found through.
+    if (options.run) {
+      throw std::runtime_error("-fprofile-generate can not be used with --run");
+    }
+    if (!options.profile.use_file.empty()) {
+      throw std::runtime_error(
+          "-fprofile-generate can not be used with -fprofile-use");
+    }
+  }
+  if (options.output_file.empty()) {
+    options.output_file = DefaultOutputFile(options.output_kind);
+  }
+  if (time_trace && options.time_trace_file.empty()) {
+    llvm::SmallString<128> path(options.output_file);
+    llvm::sys::path::replace_extension(path, "json");
+    options.time_trace_file = std::string(path);
+  }
+  return options;
+}
+
+int RunDriver(const DriverOptions& options) {
+  // Before CompileFiles starts the threads that create target machines.
+  InitializeNativeTarget();
+  if (!IsTiming(options)) {
+    return CompileProgram(options, nullptr);
+  }
+
+  std::unique_ptr<TimeReport> time_report;
+  if (options.time_report) {
+    time_report = std::make_unique<TimeReport>();
+  }
+  if (!options.time_trace_file.empty()) {
+    llvm::timeTraceProfilerInitialize(options.time_trace_granularity,
+                                      "chovl");
+  }
+
+  int exit_code = CompileProgram(options, time_report.get());
+
+  if (time_report) {
+    time_report->Print(llvm::errs());
+  }
+  if (!options.time_trace_file.empty()) {
+    if (llvm::Error error = llvm::timeTraceProfilerWrite(
+            options.time_trace_file, options.output_file)) {
+      std::cerr << "Could not write the time trace: "
+                << llvm::toString(std::move(error)) << '\n';
+    }
+    llvm::timeTraceProfilerCleanup();
+  }
+  return exit_code;
+}
+
+}  // namespace chovl
@@ -0,0 +1,53 @@
+#include "emitter.h"
+
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <stdexcept>
+
+namespace chovl {
+namespace {
+std::unique_ptr<llvm::raw_fd_ostream> OpenOutputFile(
+    const std::string& path, llvm::sys::fs::OpenFlags flags) {
+  std::error_code error;
+  auto out = std::make_unique<llvm::raw_fd_ostream>(path, error, flags);
+  if (error) {
+    throw std::runtime_error("Could not open output file: " + path + ": " +
+                             error.message());
+  }
+  return out;
+}
+}  // namespace
+
+void EmitIRFile(const llvm::Module& module, const std::string& path) {
+  std::unique_ptr<llvm::raw_fd_ostream> out =
+      OpenOutputFile(path, llvm::sys::fs::OF_Text);
+  module.print(*out, nullptr);
+}
+
+void EmitBitcodeFile(const llvm::Module& module, const std::string& path) {
+  std::unique_ptr<llvm::raw_fd_ostream> out =
+      OpenOutputFile(path, llvm::sys::fs::OF_None);
+  llvm::WriteBitcodeToFile(module, *out);
+}
+
+void EmitNativeFile(llvm::Module& module, llvm::TargetMachine& target_machine,
+                    const std::string& path, llvm::CodeGenFileType file_type) {
+  llvm::sys::fs::OpenFlags flags =
+      file_type == llvm::CodeGenFileType::AssemblyFile
+          ? llvm::sys::fs::OF_Text
+          : llvm::sys::fs::OF_None;
+  std::unique_ptr<llvm::raw_fd_ostream> out = OpenOutputFile(path, flags);
+
+  // The code generator still runs on the legacy pass manager.
+  llvm::legacy::PassManager pass_manager;
+  if (target_machine.addPassesToEmitFile(pass_manager, *out, nullptr,
+                                         file_type)) {
+    throw std::runtime_error("Target cannot emit a file of this type");
+  }
+  pass_manager.run(module);
+}
+
+}  // namespace chovl
@@ -0,0 +1,332 @@
+#include "fast_lexer.h"
+
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+
+#include "parser.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CHOVL_LEXER_SIMD 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define CHOVL_LEXER_SIMD 1
+#endif
+
+namespace chovl {
+namespace {
+bool IsSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+bool IsLetter(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool IsIdentifierChar(char c) { return IsLetter(c) || IsDigit(c); }
+
+#if defined(__AVX2__)
+using Vector = __m256i;
+constexpr size_t kVectorSize = 32;
+constexpr uint32_t kFullMask = 0xffffffff;
+
+Vector Load(const char* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+Vector Splat(char c) { return _mm256_set1_epi8(c); }
+Vector Equal(Vector a, Vector b) { return _mm256_cmpeq_epi8(a, b); }
+Vector Greater(Vector a, Vector b) { return _mm256_cmpgt_epi8(a, b); }
+Vector And(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+Vector Or(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+uint32_t Mask(Vector v) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(v));
+}
+#elif defined(__SSE2__)
+using Vector = __m128i;
+constexpr size_t kVectorSize = 16;
+constexpr uint32_t kFullMask = 0xffff;
+
+Vector Load(const char* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+Vector Splat(char c) { return _mm_set1_epi8(c); }
+Vector Equal(Vector a, Vector b) { return _mm_cmpeq_epi8(a, b); }
+Vector Greater(Vector a, Vector b) { return _mm_cmpgt_epi8(a, b); }
+Vector And(Vector a, Vector b) { return _mm_and_si128(a, b); }
+Vector Or(Vector a, Vector b) { return _mm_or_si128(a, b); }
+uint32_t Mask(Vector v) { return static_cast<uint32_t>(_mm_movemask_epi8(v)); }
+#endif
+
+#ifdef CHOVL_LEXER_SIMD
+// Bytes are compared as signed values, so bytes above 0x7f are never inside
+// an ASCII range.
+Vector InRange(Vector v, char lo, char hi) {
+  return And(Greater(v, Splat(lo - 1)), Greater(Splat(hi + 1), v));
+}
+
+Vector SpaceMask(Vector v) {
+  return Or(Or(Equal(v, Splat(' ')), Equal(v, Splat('\n'))),
+            Or(Equal(v, Splat('\t')), Equal(v, Splat('\r'))));
+}
+
+Vector IdentifierMask(Vector v) {
+  // Setting bit 5 maps upper case letters onto lower case ones, and does not
+  // move any other character into the lower case range.
+  Vector letters = InRange(Or(v, Splat(0x20)), 'a', 'z');
+  return Or(Or(letters, InRange(v, '0', '9')), Equal(v, Splat('_')));
+}
+#endif
+
+// Returns the first character in [p, end) that is not in the character class.
+template <typename VectorClass>
+const char* SkipClass(const char* p, const char* end, VectorClass vector_class,
+                      bool (*scalar_class)(char)) {
+#ifdef CHOVL_LEXER_SIMD
+  while (static_cast<size_t>(end - p) >= kVectorSize) {
+    uint32_t outside = ~Mask(vector_class(Load(p))) & kFullMask;
+    if (outside != 0) {
+      return p + std::countr_zero(outside);
+    }
+    p += kVectorSize;
+  }
+#endif
+  while (p < end && scalar_class(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+const char* SkipSpaces(const char* p, const char* end) {
+#ifdef CHOVL_LEXER_SIMD
+  return SkipClass(p, end, SpaceMask, IsSpace);
+#else
+  return SkipClass(p, end, nullptr, IsSpace);
+#endif
+}
+
+const char* SkipIdentifier(const char* p, const char* end) {
+#ifdef CHOVL_LEXER_SIMD
+  return SkipClass(p, end, IdentifierMask, IsIdentifierChar);
+#else
+  return SkipClass(p, end, nullptr, IsIdentifierChar);
+#endif
+}
+
+int LookupKeyword(std::string_view text) {
+  switch (text.size()) {
+    case 2:
+      if (text == "fn") return KW_FN;
+      if (text == "if") return KW_IF;
+      if (text == "as") return KW_AS;
+      if (text == "do") return KW_DO;
+      if (text == "in") return KW_IN;
+      break;
+    case 3:
+      if (text == "i32") return KW_I32;
+      if (text == "f32") return KW_F32;
+      if (text == "for") return KW_FOR;
+      break;
+    case 4:
+      if (text == "then") return KW_THEN;
+      if (text == "else") return KW_ELSE;
+      if (text == "char") return KW_CHAR;
+      break;
+    case 5:
+      if (text == "while") return KW_WHILE;
+      if (text == "const") return KW_CONST;
+      if (text == "f32x4") return KW_F32X4;
+      if (text == "f32x8") return KW_F32X8;
+      if (text == "i32x4") return KW_I32X4;
+      if (text == "i32x8") return KW_I32X8;
+      break;
+    case 6:
+      if (text == "struct") return KW_STRUCT;
+      break;
+  }
+  return 0;
+}
+}  // namespace
+
+int FastLexer::Lex(YYSTYPE* value) {
+  auto token = [&](int kind, size_t length) {
+    cursor_ += length;
+    return kind;
+  };
+  auto op = [&](int kind, Operator op, size_t length) {
+    value->op = op;
+    return token(kind, length);
+  };
+
+  while (true) {
+    cursor_ = SkipSpaces(cursor_, end_);
+    if (cursor_ == end_) {
+      return 0;
+    }
+
+    const char* p = cursor_;
+    size_t remaining = end_ - p;
+    char next = remaining > 1 ? p[1] : '\0';
+    switch (*p) {
+      case '(':
+        return token(OPEN_PAREN, 1);
+      case ')':
+        return token(CLOSED_PAREN, 1);
+      case '{':
+        return token(OPEN_BRACK, 1);
+      case '}':
+        return token(CLOSED_BRACK, 1);
+      case '[':
+        return token(OPEN_SQ_BRACK, 1);
+      case ']':
+        return token(CLOSED_SQ_BRACK, 1);
+      case ';':
+        return token(SEPARATOR, 1);
+      case ',':
+        return token(COMMA, 1);
+      case '@':
+        return token(AT, 1);
+      case '=':
+        if (next == '=') {
+          return op(OP_EQ, Operator::kEq, 2);
+        }
+        return token(OP_ASSIGN, 1);
+      case '&':
+        if (next == '&') {
+          return op(OP_AND, Operator::kAnd, 2);
+        }
+        return token(REF, 1);
+      case '|':
+        if (next == '|') {
+          return op(OP_OR, Operator::kOr, 2);
+        }
+        break;
+      case '!':
+        if (next == '=') {
+          return op(OP_NEQ, Operator::kNotEq, 2);
+        }
+        break;
+      case '<':
+        if (next == '=') {
+          return op(OP_LEQ, Operator::kLessEq, 2);
+        }
+        return op(OP_LT, Operator::kLessThan, 1);
+      case '>':
+        if (next == '=') {
+          return op(OP_GEQ, Operator::kGreaterEq, 2);
+        }
+        return op(OP_GT, Operator::kGreaterThan, 1);
+      case '+':
+        return op(OP_ADD, Operator::kAdd, 1);
+      case '*':
+        return op(OP_MUL, Operator::kMul, 1);
+      case '%':
+        return op(OP_MOD, Operator::kMod, 1);
+      case '/':
+        if (next == '/') {
+          const void* eol = memchr(p, '\n', remaining);
+          cursor_ = eol ? static_cast<const char*>(eol) : end_;
+          continue;
+        }
+        return op(OP_DIV, Operator::kDiv, 1);
+      case '-':
+        if (next == '>') {
+          return token(ARROW, 2);
+        }
+        if (IsDigit(next) || (next == '.' && remaining > 2 && IsDigit(p[2]))) {
+          return LexNumber(value);
+        }
+        return op(OP_SUB, Operator::kSub, 1);
+      case '.':
+        if (next == '.') {
+          return token(RANGE, 2);
+        }
+        if (IsDigit(next)) {
+          return LexNumber(value);
+        }
+        return token(DOT, 1);
+      case '\'':
+        if (remaining > 3 && next == '\\' && p[2] == 'n' && p[3] == '\'') {
+          value->chr = '\n';
+          return token(CHAR, 4);
+        }
+        if (remaining > 2 && next != '\n' && p[2] == '\'') {
+          value->chr = next;
+          return token(CHAR, 3);
+        }
+        break;
+      case '"': {
+        // Like the Flex rule, a string literal extends to the last quote on
+        // its line.
+        const void* eol = memchr(p + 1, '\n', remaining - 1);
+        const char* q = eol ? static_cast<const char*>(eol) : end_;
+        while (--q > p && *q != '"') {
+        }
+        if (q > p) {
+          value->text = {p + 1, static_cast<uint32_t>(q - p - 1)};
+          cursor_ = q + 1;
+          return STRING_LITERAL;
+        }
+        break;
+      }
+      default:
+        if (IsDigit(*p)) {
+          return LexNumber(value);
+        }
+        if (IsLetter(*p)) {
+          cursor_ = SkipIdentifier(p + 1, end_);
+          std::string_view text(p, cursor_ - p);
+          if (int keyword = LookupKeyword(text)) {
+            return keyword;
+          }
+          value->text = {p, static_cast<uint32_t>(text.size())};
+          return IDENTIFIER;
+        }
+        break;
+    }
+
+    // Anything that does not start a token is skipped, like in the Flex
+    // scanner.
+    ++cursor_;
+  }
+}
+
+int FastLexer::LexNumber(YYSTYPE* value) {
+  const char* begin = cursor_;
+  const char* digits = *begin == '-' ? begin + 1 : begin;
+
+  // The integer part is either a single 0 or has no leading zeros.
+  const char* int_end = digits;
+  if (int_end < end_ && *int_end == '0') {
+    ++int_end;
+  } else {
+    while (int_end < end_ && IsDigit(*int_end)) {
+      ++int_end;
+    }
+  }
+
+  if (end_ - int_end > 1 && *int_end == '.' && IsDigit(int_end[1])) {
+    const char* frac_end = int_end + 2;
+    while (frac_end < end_ && IsDigit(*frac_end)) {
+      ++frac_end;
+    }
+    double result = 0;
+    std::from_chars(begin, frac_end, result);
+    value->f32 = static_cast<float>(result);
+    cursor_ = frac_end;
+    return F32;
+  }
+
+  uint32_t result = 0;
+  for (const char* p = digits; p < int_end; ++p) {
+    result = result * 10 + (*p - '0');
+  }
+  value->i32 = static_cast<int32_t>(*begin == '-' ? 0u - result : result);
+  cursor_ = int_end;
+  return I32;
+}
+
+}  // namespace chovl
@@ -0,0 +1,386 @@
+#include <cmath>
+#include <cstdint>
+#include <optional>
+
+#include "ast.h"
+
+// Constant folding over the AST, which runs before codegen. Subtrees of
+// literals are evaluated with the semantics of the instructions codegen would
+// emit for them, and branches on folded conditions are pruned, so that no
+// blocks are created for code that can never run. Pruned code is kept in a
+// DeadCodeNode, which still reports its errors. Anything that would be
+// undefined or poison at runtime, like a division by zero, is left to
+// codegen.
+
+namespace chovl {
+namespace {
+enum class LiteralKind : uint8_t { kBool, kChar, kI32, kF32 };
+
+// The value of a literal node. Integers are kept sign-extended from their
+// width, the way LLVM interprets them for signed operations, so an i1 true
+// is -1.
+struct Literal {
+  LiteralKind kind;
+  int64_t integer = 0;
+  float real = 0;
+};
+
+unsigned BitWidth(LiteralKind kind) {
+  switch (kind) {
+    case LiteralKind::kBool:
+      return 1;
+    case LiteralKind::kChar:
+      return 8;
+    case LiteralKind::kI32:
+      return 32;
+    case LiteralKind::kF32:
+      break;
+  }
+  return 0;
+}
+
+// Truncates `value` to the width of `kind` and sign-extends it back.
+int64_t Wrap(LiteralKind kind, int64_t value) {
+  unsigned shift = 64 - BitWidth(kind);
+  return static_cast<int64_t>(static_cast<uint64_t>(value) << shift) >> shift;
+}
+
+int64_t MinValue(LiteralKind kind) { return Wrap(kind, INT64_MIN); }
+
+int64_t MaxValue(LiteralKind kind) { return Wrap(kind, INT64_MAX); }
+
+std::optional<Literal> GetLiteral(ASTNode* node) {
+  if (auto* literal = llvm::dyn_cast<BoolNode>(node)) {
+    return Literal{LiteralKind::kBool, literal->value() ? -1 : 0};
+  }
+  if (auto* literal = llvm::dyn_cast<CharNode>(node)) {
+    return Literal{LiteralKind::kChar, static_cast<int8_t>(literal->value())};
+  }
+  if (auto* literal = llvm::dyn_cast<I32Node>(node)) {
+    return Literal{LiteralKind::kI32, literal->value()};
+  }
+  if (auto* literal = llvm::dyn_cast<F32Node>(node)) {
+    return Literal{LiteralKind::kF32, 0, literal->value()};
+  }
+  return std::nullopt;
+}
+
+ASTNode* NewLiteral(AST& ast, const Literal& literal) {
+  switch (literal.kind) {
+    case LiteralKind::kBool:
+      return ast.New<BoolNode>(literal.integer != 0);
+    case LiteralKind::kChar:
+      return ast.New<CharNode>(static_cast<char>(literal.integer));
+    case LiteralKind::kI32:
+      return ast.New<I32Node>(static_cast<int32_t>(literal.integer));
+    case LiteralKind::kF32:
+      return ast.New<F32Node>(literal.real);
+  }
+  return nullptr;
+}
+
+Literal Bool(bool value) { return {LiteralKind::kBool, value ? -1 : 0}; }
+
+// Integer operations are signed and wrap around, like add, sdiv and icmp slt.
+std::optional<Literal> FoldInteger(Operator op, LiteralKind kind, int64_t lhs,
+                                   int64_t rhs) {
+  switch (op) {
+    case Operator::kAdd:
+      return Literal{kind, Wrap(kind, lhs + rhs)};
+    case Operator::kSub:
+      return Literal{kind, Wrap(kind, lhs - rhs)};
+    case Operator::kMul:
+      return Literal{kind, Wrap(kind, lhs * rhs)};
+    case Operator::kDiv:
+    case Operator::kMod:
+      if (rhs == 0 || (lhs == MinValue(kind) && rhs == -1)) {
+        return std::nullopt;
+      }
+      return Literal{kind, op == Operator::kDiv ? lhs / rhs : lhs % rhs};
+    case Operator::kAnd:
+      return Literal{kind, lhs & rhs};
+    case Operator::kOr:
+      return Literal{kind, lhs | rhs};
+    case Operator::kEq:
+      return Bool(lhs == rhs);
+    case Operator::kNotEq:
+      return Bool(lhs != rhs);
+    case Operator::kLessThan:
+      return Bool(lhs < rhs);
+    case Operator::kGreaterThan:
+      return Bool(lhs > rhs);
+    case Operator::kLessEq:
+      return Bool(lhs <= rhs);
+    case Operator::kGreaterEq:
+      return Bool(lhs >= rhs);
+  }
+  return std::nullopt;
+}
+
+// Comparisons of floats are unordered, i.e. true if either side is a NaN,
+// like the fcmp predicates codegen uses.
+std::optional<Literal> FoldFloat(Operator op, float lhs, float rhs) {
+  bool unordered = std::isnan(lhs) || std::isnan(rhs);
+  switch (op) {
+    case Operator::kAdd:
+      return Literal{LiteralKind::kF32, 0, lhs + rhs};
+    case Operator::kSub:
+      return Literal{LiteralKind::kF32, 0, lhs - rhs};
+    case Operator::kMul:
+      return Literal{LiteralKind::kF32, 0, lhs * rhs};
+    case Operator::kDiv:
+      return Literal{LiteralKind::kF32, 0, lhs / rhs};
+    case Operator::kMod:
+      return Literal{LiteralKind::kF32, 0, std::fmod(lhs, rhs)};
+    case Operator::kEq:
+      return Bool(unordered || lhs == rhs);
+    case Operator::kNotEq:
+      return Bool(unordered || lhs != rhs);
+    case Operator::kLessThan:
+      return Bool(unordered || lhs < rhs);
+    case Operator::kGreaterThan:
+      return Bool(unordered || lhs > rhs);
+    case Operator::kLessEq:
+      return Bool(unordered || lhs <= rhs);
+    case Operator::kGreaterEq:
+      return Bool(unordered || lhs >= rhs);
+    case Operator::kAnd:
+    case Operator::kOr:
+      break;
+  }
+  return std::nullopt;
+}
+
+// Converts like CastValue: integers are sign-extended or truncated, and
+// floats that do not fit the integer type are left alone, since fptosi
+// returns poison for them.
+std::optional<Literal> FoldCast(const Literal& value, llvm::Type* type) {
+  LiteralKind kind;
+  if (type->isIntegerTy(32)) {
+    kind = LiteralKind::kI32;
+  } else if (type->isIntegerTy(8)) {
+    kind = LiteralKind::kChar;
+  } else if (type->isFloatTy()) {
+    kind = LiteralKind::kF32;
+  } else {
+    return std::nullopt;
+  }
+
+  if (value.kind == LiteralKind::kF32) {
+    if (kind == LiteralKind::kF32) {
+      return value;
+    }
+    double truncated = std::trunc(static_cast<double>(value.real));
+    if (std::isnan(truncated) || truncated < MinValue(kind) ||
+        truncated > MaxValue(kind)) {
+      return std::nullopt;
+    }
+    return Literal{kind, static_cast<int64_t>(truncated)};
+  }
+  if (kind == LiteralKind::kF32) {
+    return Literal{kind, 0, static_cast<float>(value.integer)};
+  }
+  return Literal{kind, Wrap(kind, value.integer)};
+}
+
+BlockNode* NewEmptyBlock(AST& ast) {
+  return ast.New<BlockNode>(ast.New<ASTListNode>(), true);
+}
+
+// Returns `value` in place of a node that `dead` was pruned from. Literals
+// cannot have errors, so they are not kept.
+ASTNode* KeepDeadCode(AST& ast, ASTNode* value, ASTNode* dead) {
+  if (dead == nullptr || GetLiteral(dead)) {
+    return value;
+  }
+  return ast.New<DeadCodeNode>(value, dead);
+}
+
+// Returns the folded value of a condition, or nullptr if it is not constant.
+BoolNode* GetCondition(ASTNode* node) {
+  while (auto* dead_code = llvm::dyn_cast<DeadCodeNode>(node)) {
+    node = dead_code->value();
+  }
+  return llvm::dyn_cast<BoolNode>(node);
+}
+}  // namespace
+
+ASTNode* BinaryExprNode::fold(AST& ast) {
+  lhs_ = lhs_->fold(ast);
+  rhs_ = rhs_->fold(ast);
+
+  // A constant left-hand side of && and || that decides the result makes
+  // the right-hand side dead, since it would not be evaluated. The whole
+  // expression is kept, so that the operands are still checked against each
+  // other.
+  BoolNode* cond = GetCondition(lhs_);
+  if (cond != nullptr && cond->value() == (op_ == Operator::kOr) &&
+      (op_ == Operator::kAnd || op_ == Operator::kOr)) {
+    return KeepDeadCode(ast, cond, this);
+  }
+
+  std::optional<Literal> lhs = GetLiteral(lhs_);
+  std::optional<Literal> rhs = GetLiteral(rhs_);
+  // Operands of different types are an error that codegen reports.
+  if (!lhs || !rhs || lhs->kind != rhs->kind) {
+    return this;
+  }
+  std::optional<Literal> result =
+      lhs->kind == LiteralKind::kF32
+          ? FoldFloat(op_, lhs->real, rhs->real)
+          : FoldInteger(op_, lhs->kind, lhs->integer, rhs->integer);
+  return result ? NewLiteral(ast, *result) : this;
+}
+
+ASTNode* CastOpNode::fold(AST& ast) {
+  value_ = value_->fold(ast);
+  std::optional<Literal> value = GetLiteral(value_);
+  if (!value) {
+    return this;
+  }
+  std::optional<Literal> result =
+      FoldCast(*value, type_->llvm_type(ast.context()));
+  return result ? NewLiteral(ast, *result) : this;
+}
+
+ASTNode* ASTListNode::fold(AST& ast) {
+  for (auto& node : nodes_) {
+    node = node->fold(ast);
+  }
+  return this;
+}
+
+ASTNode* FunctionDefNode::fold(AST& ast) {
+  body_ = body_->fold(ast);
+  return this;
+}
+
+ASTNode* FunctionCallNode::fold(AST& ast) {
+  params_->fold(ast);
+  return this;
+}
+
+ASTNode* BlockNode::fold(AST& ast) {
+  body_->fold(ast);
+  return this;
+}
+
+ASTNode* VariableDeclarationNode::fold(AST& ast) {
+  if (value_ != nullptr) {
+    value_ = value_->fold(ast);
+  }
+  return this;
+}
+
+ASTNode* GlobalVariableNode::fold(AST& ast) {
+  if (values_ != nullptr) {
+    values_->fold(ast);
+  }
+  return this;
+}
+
+ASTNode* AssignmentNode::fold(AST& ast) {
+  destination_->fold(ast);
+  value_ = value_->fold(ast);
+  return this;
+}
+
+ASTNode* MultiAssignmentNode::fold(AST& ast) {
+  destination_->fold(ast);
+  values_->fold(ast);
+  return this;
+}
+
+ASTNode* CondExprNode::fold(AST& ast) {
+  cond_ = cond_->fold(ast);
+  then_ = then_->fold(ast);
+  if (else_) {
+    else_ = else_->fold(ast);
+  }
+
+  BoolNode* cond = GetCondition(cond_);
+  if (cond == nullptr || (!cond->value() && !else_)) {
+    return this;
+  }
+  ASTNode* value = cond->value() ? then_ : else_;
+  ASTNode* dead = cond->value() ? else_ : then_;
+  return KeepDeadCode(ast, KeepDeadCode(ast, value, dead), cond_);
+}
+
+ASTNode* CondStatementNode::fold(AST& ast) {
+  cond_ = cond_->fold(ast);
+  then_ = then_->fold(ast);
+  if (else_) {
+    else_ = else_->fold(ast);
+  }
+
+  BoolNode* cond = GetCondition(cond_);
+  if (cond == nullptr) {
+    return this;
+  }
+  ASTNode* taken = cond->value() ? then_ : else_;
+  ASTNode* dead = cond->value() ? else_ : then_;
+  taken = KeepDeadCode(ast, taken ? taken : NewEmptyBlock(ast), dead);
+  return KeepDeadCode(ast, taken, cond_);
+}
+
+ASTNode* WhileLoopNode::fold(AST& ast) {
+  cond_ = cond_->fold(ast);
+  body_ = body_->fold(ast);
+
+  BoolNode* cond = GetCondition(cond_);
+  if (cond != nullptr && !cond->value()) {
+    return KeepDeadCode(ast, KeepDeadCode(ast, NewEmptyBlock(ast), body_),
+                        cond_);
+  }
+  return this;
+}
+
+ASTNode* ForLoopNode::fold(AST& ast) {
+  begin_ = begin_->fold(ast);
+  end_ = end_->fold(ast);
+  body_ = body_->fold(ast);
+
+  auto* begin = llvm::dyn_cast<I32Node>(begin_);
+  auto* end = llvm::dyn_cast<I32Node>(end_);
+  // The body needs the loop variable, so the whole loop is kept.
+  if (begin != nullptr && end != nullptr && begin->value() >= end->value()) {
+    return KeepDeadCode(ast, NewEmptyBlock(ast), this);
+  }
+  return this;
+}
+
+ASTNode* ArrayAccessNode::fold(AST& ast) {
+  index_ = index_->fold(ast);
+  return this;
+}
+
+ASTNode* FieldAccessNode::fold(AST& ast) {
+  base_->fold(ast);
+  return this;
+}
+
+ASTNode* SliceNode::fold(AST& ast) {
+  begin_ = begin_->fold(ast);
+  end_ = end_->fold(ast);
+  return this;
+}
+
+ASTNode* VariableListNode::fold(AST& ast) {
+  for (auto& node : nodes_) {
+    node->fold(ast);
+  }
+  return this;
+}
+
+ASTNode* GetAddressNode::fold(AST& ast) {
+  node_->fold(ast);
+  return this;
+}
+
+ASTNode* DereferenceNode::fold(AST& ast) {
+  node_->fold(ast);
+  return this;
+}
+
+}  // namespace chovl
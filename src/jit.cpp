@@ -0,0 +1,54 @@
+#include "jit.h"
+
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/Support/TargetSelect.h>
+
+#include <stdexcept>
+
+namespace chovl {
+
+using llvm::orc::DynamicLibrarySearchGenerator;
+
+namespace {
+void CheckError(llvm::Error error) {
+  if (error) {
+    throw std::runtime_error("JIT: " + llvm::toString(std::move(error)));
+  }
+}
+
+template <typename T>
+T CheckExpected(llvm::Expected<T> expected) {
+  CheckError(expected.takeError());
+  return std::move(*expected);
+}
+}  // namespace
+
+int RunModule(std::unique_ptr<llvm::Module> module,
+              std::unique_ptr<llvm::LLVMContext> llvm_context) {
+  llvm::Function* main_func = module->getFunction("main");
+  if (main_func == nullptr || main_func->isDeclaration()) {
+    throw std::runtime_error("JIT: no definition of main found");
+  }
+  bool returns_int = main_func->getReturnType()->isIntegerTy(32);
+
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  std::unique_ptr<llvm::orc::LLJIT> jit =
+      CheckExpected(llvm::orc::LLJITBuilder().create());
+  jit->getMainJITDylib().addGenerator(
+      CheckExpected(DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          jit->getDataLayout().getGlobalPrefix())));
+  CheckError(jit->addIRModule(
+      llvm::orc::ThreadSafeModule(std::move(module), std::move(llvm_context))));
+
+  llvm::orc::ExecutorAddr main_addr = CheckExpected(jit->lookup("main"));
+  if (returns_int) {
+    return main_addr.toPtr<int (*)()>()();
+  }
+  main_addr.toPtr<void (*)()>()();
+  return 0;
+}
+
+}  // namespace chovl
@@ -4,6 +4,17 @@ namespace chovl {
 
 llvm::Value* CreateBinaryOperation(llvm::IRBuilder<>* builder, Operator op,
                                    llvm::Value* lhs, llvm::Value* rhs) {
+  // A scalar operand of an operation on vectors applies to every lane.
+  auto* lhs_vector = llvm::dyn_cast<llvm::FixedVectorType>(lhs->getType());
+  auto* rhs_vector = llvm::dyn_cast<llvm::FixedVectorType>(rhs->getType());
+  if (lhs_vector && !rhs_vector &&
+      lhs_vector->getElementType() == rhs->getType()) {
+    rhs = builder->CreateVectorSplat(lhs_vector->getNumElements(), rhs);
+  } else if (rhs_vector && !lhs_vector &&
+             rhs_vector->getElementType() == lhs->getType()) {
+    lhs = builder->CreateVectorSplat(rhs_vector->getNumElements(), lhs);
+  }
+
   if (lhs->getType() != rhs->getType()) {
     std::string error_str = "BinaryExprNode: lhs and rhs types do not match: ";
     llvm::raw_string_ostream rso(error_str);
@@ -13,59 +24,60 @@ llvm::Value* CreateBinaryOperation(llvm::IRBuilder<>* builder, Operator op,
     throw std::runtime_error(rso.str());
   }
 
+  bool is_float = lhs->getType()->isFPOrFPVectorTy();
   switch (op) {
     case Operator::kAdd:
-      if (lhs->getType()->isFloatingPointTy()) {
+      if (is_float) {
         return builder->CreateFAdd(lhs, rhs, "addtmp");
       }
       return builder->CreateAdd(lhs, rhs, "addtmp");
     case Operator::kSub:
-      if (lhs->getType()->isFloatingPointTy()) {
+      if (is_float) {
         return builder->CreateFSub(lhs, rhs, "addtmp");
       }
       return builder->CreateSub(lhs, rhs, "addtmp");
     case Operator::kDiv:
-      if (lhs->getType()->isFloatingPointTy()) {
+      if (is_float) {
         return builder->CreateFDiv(lhs, rhs, "divtmp");
       }
       return builder->CreateSDiv(lhs, rhs, "divtmp");
     case Operator::kMul:
-      if (lhs->getType()->isFloatingPointTy()) {
+      if (is_float) {
         return builder->CreateFMul(lhs, rhs, "multmp");
       }
       return builder->CreateMul(lhs, rhs, "multmp");
     case Operator::kMod:
-      if (lhs->getType()->isFloatingPointTy()) {
+      if (is_float) {
         return builder->CreateFRem(lhs, rhs, "modtmp");
       }
       return builder->CreateSRem(lhs, rhs, "modtmp");
     case Operator::kEq:
-      if (lhs->getType()->isFloatingPointTy()) {
+      if (is_float) {
         return builder->CreateFCmpUEQ(lhs, rhs, "cmptmp");
       }
       return builder->CreateICmpEQ(lhs, rhs, "cmptmp");
     case Operator::kNotEq:
-      if (lhs->getType()->isFloatingPointTy()) {
+      if (is_float) {
         return builder->CreateFCmpUNE(lhs, rhs, "cmptmp");
       }
       return builder->CreateICmpNE(lhs, rhs, "cmptmp");
     case Operator::kLessThan:
-      if (lhs->getType()->isFloatingPointTy()) {
+      if (is_float) {
         return builder->CreateFCmpULT(lhs, rhs, "cmptmp");
       }
       return builder->CreateICmpSLT(lhs, rhs, "cmptmp");
     case Operator::kGreaterThan:
-      if (lhs->getType()->isFloatingPointTy()) {
+      if (is_float) {
         return builder->CreateFCmpUGT(lhs, rhs, "cmptmp");
       }
       return builder->CreateICmpSGT(lhs, rhs, "cmptmp");
     case Operator::kLessEq:
-      if (lhs->getType()->isFloatingPointTy()) {
+      if (is_float) {
         return builder->CreateFCmpULE(lhs, rhs, "cmptmp");
       }
       return builder->CreateICmpSLE(lhs, rhs, "cmptmp");
     case Operator::kGreaterEq:
-      if (lhs->getType()->isFloatingPointTy()) {
+      if (is_float) {
         return builder->CreateFCmpUGE(lhs, rhs, "cmptmp");
       }
       return builder->CreateICmpSGE(lhs, rhs, "cmptmp");
@@ -0,0 +1,202 @@
+#include "optimizer.h"
+
+#include <llvm/ADT/StringSet.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/StandardInstrumentations.h>
+#include <llvm/Support/PGOOptions.h>
+#include <llvm/Support/VirtualFileSystem.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
+
+#include <optional>
+
+namespace chovl {
+namespace {
+llvm::OptimizationLevel GetLLVMOptimizationLevel(OptimizationLevel level) {
+  switch (level) {
+    case OptimizationLevel::kO0:
+      return llvm::OptimizationLevel::O0;
+    case OptimizationLevel::kO1:
+      return llvm::OptimizationLevel::O1;
+    case OptimizationLevel::kO2:
+      return llvm::OptimizationLevel::O2;
+    case OptimizationLevel::kO3:
+      return llvm::OptimizationLevel::O3;
+    case OptimizationLevel::kOs:
+      return llvm::OptimizationLevel::Os;
+  }
+  return llvm::OptimizationLevel::O0;
+}
+
+std::optional<llvm::PGOOptions> GetPGOOptions(const ProfileConfig& profile) {
+  if (!profile.generate_file.empty()) {
+    return llvm::PGOOptions(profile.generate_file, "", "", "",
+                            llvm::vfs::getRealFileSystem(),
+                            llvm::PGOOptions::IRInstr);
+  }
+  if (!profile.use_file.empty()) {
+    return llvm::PGOOptions(profile.use_file, "", "", "",
+                            llvm::vfs::getRealFileSystem(),
+                            llvm::PGOOptions::IRUse);
+  }
+  return std::nullopt;
+}
+
+// On Linux the instrumentation expects the linker to be told to pull in the
+// profile runtime, which clang's driver does. A reference from the module
+// itself makes linking with the chovl_profile library enough.
+void AddProfileRuntimeHook(llvm::Module& module) {
+  if (module.getFunction("__llvm_profile_runtime_user") != nullptr) {
+    return;
+  }
+  llvm::LLVMContext& context = module.getContext();
+  llvm::Type* int_type = llvm::Type::getInt32Ty(context);
+  auto* runtime = llvm::cast<llvm::GlobalVariable>(
+      module.getOrInsertGlobal("__llvm_profile_runtime", int_type));
+  runtime->setVisibility(llvm::GlobalValue::HiddenVisibility);
+
+  llvm::Function* hook = llvm::Function::Create(
+      llvm::FunctionType::get(int_type, false),
+      llvm::GlobalValue::LinkOnceODRLinkage, "__llvm_profile_runtime_user",
+      module);
+  hook->setVisibility(llvm::GlobalValue::HiddenVisibility);
+  hook->addFnAttr(llvm::Attribute::NoInline);
+  llvm::IRBuilder<> builder(llvm::BasicBlock::Create(context, "", hook));
+  builder.CreateRet(builder.CreateLoad(int_type, runtime));
+  llvm::appendToCompilerUsed(module, {hook});
+}
+
+// Sets up the analyses and instrumentation and runs the pipeline that
+// `build_pipeline` returns over the module.
+template <typename BuildPipeline>
+void RunPipeline(llvm::Module& module, llvm::TargetMachine* target_machine,
+                 TimeReport* time_report, const ProfileConfig& profile,
+                 BuildPipeline build_pipeline) {
+  llvm::PassInstrumentationCallbacks instrumentation;
+  llvm::TimeProfilingPassesHandler trace_passes;
+  trace_passes.registerCallbacks(instrumentation);
+  if (time_report != nullptr) {
+    time_report->RegisterPassCallbacks(instrumentation);
+  }
+
+  llvm::LoopAnalysisManager loop_am;
+  llvm::FunctionAnalysisManager function_am;
+  llvm::CGSCCAnalysisManager cgscc_am;
+  llvm::ModuleAnalysisManager module_am;
+
+  llvm::PassBuilder pass_builder(target_machine, llvm::PipelineTuningOptions(),
+                                 GetPGOOptions(profile), &instrumentation);
+  pass_builder.registerModuleAnalyses(module_am);
+  pass_builder.registerCGSCCAnalyses(cgscc_am);
+  pass_builder.registerFunctionAnalyses(function_am);
+  pass_builder.registerLoopAnalyses(loop_am);
+  pass_builder.crossRegisterProxies(loop_am, function_am, cgscc_am, module_am);
+
+  llvm::ModulePassManager module_pm = build_pipeline(pass_builder);
+  module_pm.run(module, module_am);
+
+  if (!profile.generate_file.empty()) {
+    AddProfileRuntimeHook(module);
+  }
+}
+
+// Whether the function makes or receives a musttail call, which requires the
+// calling conventions of caller and callee to match.
+bool HasMustTailCalls(const llvm::Function& function) {
+  for (const llvm::User* user : function.users()) {
+    auto* call = llvm::dyn_cast<llvm::CallInst>(user);
+    if (call != nullptr && call->isMustTailCall()) {
+      return true;
+    }
+  }
+  for (const llvm::BasicBlock& block : function) {
+    if (block.getTerminatingMustTailCall() != nullptr) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Functions that only the program itself calls do not need to follow the C
+// calling convention, and fastcc passes more arguments in registers.
+void UseFastCallingConvention(llvm::Module& module) {
+  for (llvm::Function& function : module) {
+    if (function.isDeclaration() || !function.hasLocalLinkage() ||
+        function.isVarArg() || function.hasAddressTaken() ||
+        HasMustTailCalls(function)) {
+      continue;
+    }
+    function.setCallingConv(llvm::CallingConv::Fast);
+    for (llvm::User* user : function.users()) {
+      if (auto* call = llvm::dyn_cast<llvm::CallBase>(user)) {
+        call->setCallingConv(llvm::CallingConv::Fast);
+      }
+    }
+  }
+}
+}  // namespace
+
+void OptimizeModule(llvm::Module& module, OptimizationLevel level,
+                    llvm::TargetMachine* target_machine,
+                    TimeReport* time_report, const ProfileConfig& profile) {
+  PhaseScope scope(time_report, "Optimize");
+  llvm::OptimizationLevel llvm_level = GetLLVMOptimizationLevel(level);
+  RunPipeline(module, target_machine, time_report, profile,
+              [&](llvm::PassBuilder& pass_builder) {
+                return level == OptimizationLevel::kO0
+                           ? pass_builder.buildO0DefaultPipeline(llvm_level)
+                           : pass_builder.buildPerModuleDefaultPipeline(
+                                 llvm_level);
+              });
+}
+
+void OptimizeModuleForLTO(llvm::Module& module, OptimizationLevel level,
+                          llvm::TargetMachine* target_machine,
+                          TimeReport* time_report,
+                          const ProfileConfig& profile) {
+  PhaseScope scope(time_report, "Optimize");
+  llvm::OptimizationLevel llvm_level = GetLLVMOptimizationLevel(level);
+  RunPipeline(module, target_machine, time_report, profile,
+              [&](llvm::PassBuilder& pass_builder) {
+                return level == OptimizationLevel::kO0
+                           ? pass_builder.buildO0DefaultPipeline(
+                                 llvm_level, /*LTOPreLink=*/true)
+                           : pass_builder.buildLTOPreLinkDefaultPipeline(
+                                 llvm_level);
+              });
+}
+
+void OptimizeProgram(llvm::Module& module, OptimizationLevel level,
+                     llvm::TargetMachine* target_machine,
+                     const std::vector<std::string>& exports,
+                     TimeReport* time_report, const ProfileConfig& profile) {
+  PhaseScope scope(time_report, "Link-time optimization");
+  llvm::StringSet<> preserved;
+  preserved.insert("main");
+  for (const std::string& name : exports) {
+    preserved.insert(name);
+  }
+  llvm::internalizeModule(module, [&](const llvm::GlobalValue& global) {
+    // The profile runtime finds the version and file name of a profile by
+    // their names.
+    return preserved.contains(global.getName()) ||
+           global.getName().starts_with("__llvm_profile_");
+  });
+  UseFastCallingConvention(module);
+
+  // Instrumentation is added before linking, while the branch weights of a
+  // profile also guide the post-link passes.
+  ProfileConfig use_profile;
+  use_profile.use_file = profile.use_file;
+  llvm::OptimizationLevel llvm_level = GetLLVMOptimizationLevel(level);
+  RunPipeline(module, target_machine, time_report, use_profile,
+              [&](llvm::PassBuilder& pass_builder) {
+                return level == OptimizationLevel::kO0
+                           ? pass_builder.buildO0DefaultPipeline(llvm_level)
+                           : pass_builder.buildLTODefaultPipeline(
+                                 llvm_level, /*ExportSummary=*/nullptr);
+              });
+}
+
+}  // namespace chovl
@@ -1,62 +1,190 @@
 #include "scope.h"
 
+#include <llvm/Support/MathExtras.h>
+
+#include <stdexcept>
+#include <string>
+
 namespace chovl {
 namespace {
 llvm::Type* GetLLVMType(PrimitiveType kind, Context& context) {
+  llvm::Type* i32_type = llvm::Type::getInt32Ty(*context.llvm_context);
+  llvm::Type* f32_type = llvm::Type::getFloatTy(*context.llvm_context);
   switch (kind) {
     case PrimitiveType::kI32:
-      return llvm::Type::getInt32Ty(context.llvm_context);
+      return i32_type;
     case PrimitiveType::kF32:
-      return llvm::Type::getFloatTy(context.llvm_context);
+      return f32_type;
     case PrimitiveType::kChar:
-      return llvm::Type::getInt8Ty(context.llvm_context);
+      return llvm::Type::getInt8Ty(*context.llvm_context);
+    case PrimitiveType::kF32x4:
+      return llvm::FixedVectorType::get(f32_type, 4);
+    case PrimitiveType::kF32x8:
+      return llvm::FixedVectorType::get(f32_type, 8);
+    case PrimitiveType::kI32x4:
+      return llvm::FixedVectorType::get(i32_type, 4);
+    case PrimitiveType::kI32x8:
+      return llvm::FixedVectorType::get(i32_type, 8);
     case PrimitiveType::kNone:
-      return llvm::Type::getVoidTy(context.llvm_context);
+      return llvm::Type::getVoidTy(*context.llvm_context);
+    case PrimitiveType::kStruct:
+      break;
   }
   return nullptr;
 }
+
+PrimitiveType GetPrimitiveType(llvm::Type* type) {
+  if (auto* vector_type = llvm::dyn_cast<llvm::FixedVectorType>(type)) {
+    bool is_float = vector_type->getElementType()->isFloatTy();
+    switch (vector_type->getNumElements()) {
+      case 4:
+        return is_float ? PrimitiveType::kF32x4 : PrimitiveType::kI32x4;
+      case 8:
+        return is_float ? PrimitiveType::kF32x8 : PrimitiveType::kI32x8;
+    }
+  } else if (type->isIntegerTy(32)) {
+    return PrimitiveType::kI32;
+  } else if (type->isFloatTy()) {
+    return PrimitiveType::kF32;
+  } else if (type->isIntegerTy(8)) {
+    return PrimitiveType::kChar;
+  }
+  return PrimitiveType::kNone;
+}
 }  // namespace
 
+llvm::StructType* GetSliceType(llvm::LLVMContext& context) {
+  return llvm::StructType::get(llvm::PointerType::get(context, 0),
+                               llvm::Type::getInt32Ty(context));
+}
+
 Type::Type(llvm::Type* type) {
   aggregate_kind_ = AggregateType::kSingular;
-  if (type->isIntegerTy(32)) {
-    kind_ = PrimitiveType::kI32;
-  } else if (type->isFloatTy()) {
-    kind_ = PrimitiveType::kF32;
-  } else if (type->isIntegerTy(8)) {
-    kind_ = PrimitiveType::kChar;
-  } else if (type->isVoidTy()) {
-    kind_ = PrimitiveType::kNone;
-  } else if (type->isArrayTy()) {
+  indirection_ = type->isPointerTy() ? IndirectionType::kPointer
+                                     : IndirectionType::kNone;
+  size_ = 1;
+  if (type->isArrayTy()) {
     auto array_type = llvm::cast<llvm::ArrayType>(type);
     size_ = array_type->getNumElements();
-    if (array_type->getElementType()->isIntegerTy(32)) {
-      kind_ = PrimitiveType::kI32;
-    } else if (array_type->getElementType()->isFloatTy()) {
-      kind_ = PrimitiveType::kF32;
-    } else if (array_type->getElementType()->isIntegerTy(8)) {
-      kind_ = PrimitiveType::kChar;
-    }
+    kind_ = GetPrimitiveType(array_type->getElementType());
     aggregate_kind_ = AggregateType::kArray;
+  } else {
+    kind_ = GetPrimitiveType(type);
+  }
+}
+
+Type Type::Slice(PrimitiveType kind) {
+  Type type(kind, IndirectionType::kNone);
+  type.aggregate_kind_ = AggregateType::kSlice;
+  return type;
+}
+
+Type Type::Slice(const StructInfo* info) {
+  Type type = Slice(PrimitiveType::kStruct);
+  type.struct_info_ = info;
+  return type;
+}
+
+Type Type::element() const {
+  Type type(kind_, IndirectionType::kNone);
+  type.struct_info_ = struct_info_;
+  return type;
+}
+
+bool Type::is_soa() const {
+  return struct_info_ != nullptr && struct_info_->is_soa() &&
+         aggregate_kind_ == AggregateType::kArray &&
+         indirection_ == IndirectionType::kNone;
+}
+
+uint32_t Type::alignment() const {
+  if (struct_info_ == nullptr || indirection_ == IndirectionType::kPointer ||
+      aggregate_kind_ == AggregateType::kSlice) {
+    return 0;
   }
+  return struct_info_->alignment();
+}
+
+llvm::Type* Type::ElementLLVMType(Context& context) const {
+  if (struct_info_ != nullptr) {
+    return struct_info_->llvm_type(context);
+  }
+  return GetLLVMType(kind_, context);
 }
 
 llvm::Type* Type::llvm_type(Context& context) const {
+  // Pointers are opaque, so the type they point to is not needed, which
+  // also lets a struct point to its own type.
   if (indirection_ == IndirectionType::kPointer) {
-    return llvm::PointerType::getUnqual(GetLLVMType(kind_, context));
+    return llvm::PointerType::get(*context.llvm_context, 0);
   }
   switch (aggregate_kind_) {
     case AggregateType::kSingular:
-      return GetLLVMType(kind_, context);
+      return ElementLLVMType(context);
     case AggregateType::kArray:
-      return llvm::ArrayType::get(GetLLVMType(kind_, context), size_);
+      if (is_soa()) {
+        return struct_info_->soa_type(context, size_);
+      }
+      return llvm::ArrayType::get(ElementLLVMType(context), size_);
+    case AggregateType::kSlice:
+      return GetSliceType(*context.llvm_context);
   }
 
   return nullptr;
 }
 
+unsigned StructInfo::field_index(Identifier name) const {
+  for (unsigned i = 0; i < fields_.size(); ++i) {
+    if (fields_[i].name.id == name.id) {
+      return i;
+    }
+  }
+  throw std::runtime_error("No field " + std::string(name.name) +
+                           " in struct " + std::string(name_.name));
+}
+
+llvm::StructType* StructInfo::llvm_type(Context& context) const {
+  llvm::LLVMContext& llvm_context = *context.llvm_context;
+  std::string type_name = "struct." + std::string(name_.name);
+  if (auto* type = llvm::StructType::getTypeByName(llvm_context, type_name)) {
+    return type;
+  }
+
+  std::vector<llvm::Type*> elements;
+  for (const Field& field : fields_) {
+    elements.push_back(field.type.llvm_type(context));
+  }
+  // The padding for @align(N) is a trailing byte array after the fields, so
+  // it does not shift their indices. The size is taken from a literal struct
+  // of the same elements, since the data layout caches the layout of the
+  // named one.
+  if (alignment_ != 0) {
+    uint64_t size = context.llvm_module->getDataLayout().getTypeAllocSize(
+        llvm::StructType::get(llvm_context, elements, is_packed_));
+    uint64_t padding = llvm::alignTo(size, alignment_) - size;
+    if (padding != 0) {
+      elements.push_back(
+          llvm::ArrayType::get(llvm::Type::getInt8Ty(llvm_context), padding));
+    }
+  }
+  return llvm::StructType::create(llvm_context, elements, type_name,
+                                  is_packed_);
+}
+
+llvm::StructType* StructInfo::soa_type(Context& context, size_t size) const {
+  std::vector<llvm::Type*> elements;
+  for (const Field& field : fields_) {
+    elements.push_back(
+        llvm::ArrayType::get(field.type.llvm_type(context), size));
+  }
+  return llvm::StructType::get(*context.llvm_context, elements);
+}
+
 SymbolicValue::SymbolicValue(SymbolicValue&& other) noexcept
-    : value_(other.value_), type_(other.type_), alloca_(other.alloca_) {
+    : value_(other.value_),
+      type_(other.type_),
+      alloca_(other.alloca_),
+      is_constant_(other.is_constant_) {
   other.value_ = nullptr;
 }
 
@@ -64,37 +192,48 @@ SymbolicValue& SymbolicValue::operator=(SymbolicValue&& other) noexcept {
   value_ = other.value_;
   type_ = other.type_;
   alloca_ = other.alloca_;
+  is_constant_ = other.is_constant_;
   other.value_ = nullptr;
   other.alloca_ = nullptr;
   return *this;
 }
 
-void SymbolTable::AddSymbol(const std::string& name, SymbolicValue value) {
-  symbols_.back().emplace(name, std::move(value));
+void SymbolTable::AddSymbol(SymbolId id, SymbolicValue value) {
+  if (id >= innermost_.size()) {
+    innermost_.resize(id + 1, kUnbound);
+  }
+  // A name that is declared again in the same scope keeps its first binding.
+  if (innermost_[id] != kUnbound && !scope_starts_.empty() &&
+      innermost_[id] >= scope_starts_.back()) {
+    return;
+  }
+  bindings_.push_back({id, innermost_[id], std::move(value)});
+  innermost_[id] = bindings_.size() - 1;
 }
 
-SymbolicValue& SymbolTable::GetSymbol(const std::string& name) {
-  for (auto it = symbols_.rbegin(); it != symbols_.rend(); ++it) {
-    auto symbol = it->find(name);
-    if (symbol != it->end()) {
-      return symbol->second;
-    }
+SymbolicValue& SymbolTable::GetSymbol(SymbolId id) {
+  if (id >= innermost_.size() || innermost_[id] == kUnbound) {
+    throw std::runtime_error("Symbol not found");
   }
-  throw std::runtime_error("Symbol not found");
+  return bindings_[innermost_[id]].value;
 }
 
-const SymbolicValue& SymbolTable::GetSymbol(const std::string& name) const {
-  for (auto it = symbols_.rbegin(); it != symbols_.rend(); ++it) {
-    auto symbol = it->find(name);
-    if (symbol != it->end()) {
-      return symbol->second;
-    }
+const SymbolicValue& SymbolTable::GetSymbol(SymbolId id) const {
+  if (id >= innermost_.size() || innermost_[id] == kUnbound) {
+    throw std::runtime_error("Symbol not found");
   }
-  throw std::runtime_error("Symbol not found");
+  return bindings_[innermost_[id]].value;
 }
 
-void SymbolTable::AddScope() { symbols_.emplace_back(); }
+void SymbolTable::AddScope() { scope_starts_.push_back(bindings_.size()); }
 
-void SymbolTable::RemoveScope() { symbols_.pop_back(); }
+void SymbolTable::RemoveScope() {
+  size_t start = scope_starts_.back();
+  scope_starts_.pop_back();
+  while (bindings_.size() > start) {
+    innermost_[bindings_.back().id] = bindings_.back().shadowed;
+    bindings_.pop_back();
+  }
+}
 
 }  // namespace chovl
@@ -0,0 +1,126 @@
+#include "tail_calls.h"
+
+#include <llvm/Analysis/CaptureTracking.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+
+namespace chovl {
+namespace {
+bool MayEscapeFrame(llvm::Function& function) {
+  for (llvm::Instruction& inst : function.getEntryBlock()) {
+    if (llvm::isa<llvm::AllocaInst>(inst) &&
+        llvm::PointerMayBeCaptured(&inst, /*ReturnCaptures=*/true,
+                                   /*StoreCaptures=*/true)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OnlyMerges(llvm::BasicBlock* block) {
+  return block->getFirstNonPHI() == block->getTerminator();
+}
+
+// Makes `block` end in a return if it branches to one through blocks that
+// contain nothing but PHIs, and returns it. The returns are duplicated, and
+// merge blocks that are left without predecessors are deleted.
+llvm::ReturnInst* FoldReturnInto(llvm::BasicBlock* block) {
+  llvm::Instruction* terminator = block->getTerminator();
+  if (auto* ret = llvm::dyn_cast<llvm::ReturnInst>(terminator)) {
+    return ret;
+  }
+  auto* branch = llvm::dyn_cast<llvm::BranchInst>(terminator);
+  if (branch == nullptr || branch->isConditional()) {
+    return nullptr;
+  }
+
+  llvm::BasicBlock* successor = branch->getSuccessor(0);
+  if (!OnlyMerges(successor)) {
+    return nullptr;
+  }
+  llvm::ReturnInst* successor_ret = FoldReturnInto(successor);
+  if (successor_ret == nullptr) {
+    return nullptr;
+  }
+
+  llvm::ReturnInst* ret =
+      llvm::FoldReturnIntoUncondBranch(successor_ret, successor, block);
+  if (llvm::pred_empty(successor)) {
+    llvm::DeleteDeadBlock(successor);
+  }
+  return ret;
+}
+
+// The parameters are stored in allocas at the start of the entry block, right
+// after the allocas themselves. Returns the first instruction of the body.
+llvm::Instruction* FindBodyStart(llvm::Function& function,
+                                 std::vector<llvm::Value*>& param_allocas) {
+  param_allocas.assign(function.arg_size(), nullptr);
+  for (llvm::Instruction& inst : function.getEntryBlock()) {
+    if (llvm::isa<llvm::AllocaInst>(inst)) {
+      continue;
+    }
+    auto* store = llvm::dyn_cast<llvm::StoreInst>(&inst);
+    auto* arg = store ? llvm::dyn_cast<llvm::Argument>(store->getValueOperand())
+                      : nullptr;
+    if (arg == nullptr) {
+      return &inst;
+    }
+    param_allocas[arg->getArgNo()] = store->getPointerOperand();
+  }
+  return function.getEntryBlock().getTerminator();
+}
+}  // namespace
+
+void LowerTailCalls(llvm::Function& function,
+                    llvm::ArrayRef<llvm::CallInst*> calls, TailCallMode mode) {
+  if (mode == TailCallMode::kNone || calls.empty() ||
+      MayEscapeFrame(function)) {
+    return;
+  }
+
+  llvm::BasicBlock* loop_header = nullptr;
+  std::vector<llvm::Value*> param_allocas;
+  for (llvm::CallInst* call : calls) {
+    call->setTailCall();
+    if (mode != TailCallMode::kGuaranteed) {
+      continue;
+    }
+
+    llvm::Function* callee = call->getCalledFunction();
+    bool is_recursive = callee == &function;
+    if (callee == nullptr ||
+        callee->getFunctionType() != function.getFunctionType() ||
+        callee->getCallingConv() != function.getCallingConv()) {
+      continue;
+    }
+
+    llvm::ReturnInst* ret = FoldReturnInto(call->getParent());
+    if (ret == nullptr || call->getNextNode() != ret ||
+        (ret->getReturnValue() != nullptr && ret->getReturnValue() != call)) {
+      continue;
+    }
+    if (!is_recursive) {
+      call->setTailCallKind(llvm::CallInst::TCK_MustTail);
+      continue;
+    }
+
+    // Turn the recursion into a loop: the arguments become the new values of
+    // the parameters, and the body starts over.
+    if (loop_header == nullptr) {
+      llvm::Instruction* body_start = FindBodyStart(function, param_allocas);
+      loop_header = function.getEntryBlock().splitBasicBlock(body_start,
+                                                             "tailrecurse");
+    }
+    llvm::IRBuilder<> builder(call);
+    for (unsigned i = 0; i < call->arg_size(); ++i) {
+      builder.CreateStore(call->getArgOperand(i), param_allocas[i]);
+    }
+    builder.CreateBr(loop_header);
+    ret->eraseFromParent();
+    call->eraseFromParent();
+  }
+}
+
+}  // namespace chovl
@@ -0,0 +1,110 @@
+#include "target.h"
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/TargetParser/Host.h>
+
+#include <stdexcept>
+
+namespace chovl {
+namespace {
+llvm::CodeGenOptLevel GetCodeGenOptLevel(OptimizationLevel level) {
+  switch (level) {
+    case OptimizationLevel::kO0:
+      return llvm::CodeGenOptLevel::None;
+    case OptimizationLevel::kO1:
+      return llvm::CodeGenOptLevel::Less;
+    case OptimizationLevel::kO2:
+    case OptimizationLevel::kOs:
+      return llvm::CodeGenOptLevel::Default;
+    case OptimizationLevel::kO3:
+      return llvm::CodeGenOptLevel::Aggressive;
+  }
+  return llvm::CodeGenOptLevel::Default;
+}
+
+// Returns the features of the host processor, e.g. "+avx2,-avx512f", since
+// the name of the processor alone does not say which of them are enabled.
+std::string GetHostFeatures() {
+  llvm::StringMap<bool> host_features;
+  if (!llvm::sys::getHostCPUFeatures(host_features)) {
+    return "";
+  }
+  std::string features;
+  for (const auto& feature : host_features) {
+    if (!features.empty()) {
+      features += ',';
+    }
+    features += feature.second ? '+' : '-';
+    features += feature.first();
+  }
+  return features;
+}
+}  // namespace
+
+void InitializeNativeTarget() {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+}
+
+std::unique_ptr<llvm::TargetMachine> CreateTargetMachine(
+    OptimizationLevel level, const TargetConfig& config) {
+  std::string triple = llvm::sys::getDefaultTargetTriple();
+  std::string error;
+  const llvm::Target* target =
+      llvm::TargetRegistry::lookupTarget(triple, error);
+  if (target == nullptr) {
+    throw std::runtime_error("Could not find target " + triple + ": " + error);
+  }
+
+  std::string cpu = config.cpu;
+  std::string features;
+  if (cpu == "native") {
+    cpu = llvm::sys::getHostCPUName().str();
+    features = GetHostFeatures();
+  }
+  // Explicit features come last, so that they override the host's.
+  if (!config.features.empty()) {
+    if (!features.empty()) {
+      features += ',';
+    }
+    features += config.features;
+  }
+
+  // Executables are linked with the system compiler, which produces PIEs by
+  // default, so the generated code has to be position independent.
+  std::unique_ptr<llvm::TargetMachine> target_machine(
+      target->createTargetMachine(triple, cpu, features, llvm::TargetOptions(),
+                                  llvm::Reloc::PIC_, std::nullopt,
+                                  GetCodeGenOptLevel(level)));
+  if (!target_machine->getMCSubtargetInfo()->isCPUStringValid(cpu)) {
+    throw std::runtime_error("Unknown processor " + cpu + " for target " +
+                             triple);
+  }
+  return target_machine;
+}
+
+void ConfigureModule(llvm::Module& module,
+                     const llvm::TargetMachine& target_machine) {
+  module.setTargetTriple(target_machine.getTargetTriple().str());
+  module.setDataLayout(target_machine.createDataLayout());
+}
+
+void SetTargetAttributes(llvm::Module& module,
+                         const llvm::TargetMachine& target_machine) {
+  llvm::StringRef cpu = target_machine.getTargetCPU();
+  llvm::StringRef features = target_machine.getTargetFeatureString();
+  for (llvm::Function& function : module) {
+    if (function.isDeclaration()) {
+      continue;
+    }
+    function.addFnAttr("target-cpu", cpu);
+    if (!features.empty()) {
+      function.addFnAttr("target-features", features);
+    }
+  }
+}
+
+}  // namespace chovl
@@ -0,0 +1,145 @@
+#include "timing.h"
+
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/Passes/StandardInstrumentations.h>
+#include <llvm/Support/Format.h>
+
+#include <algorithm>
+
+namespace chovl {
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct OpenPhase {
+  std::string name;
+  Clock::time_point start;
+  // When the phase last became the innermost one of its thread.
+  Clock::time_point resumed;
+  double exclusive_seconds;
+};
+
+thread_local std::vector<OpenPhase> open_phases;
+
+double Seconds(Clock::duration duration) {
+  return std::chrono::duration<double>(duration).count();
+}
+
+// Pass managers and adaptors only run other passes, which are timed on their
+// own.
+bool IsPassManager(llvm::StringRef pass) {
+  static const std::vector<llvm::StringRef> kPassManagers = {
+      "PassManager", "PassAdaptor", "AnalysisManagerProxy",
+      "DevirtSCCRepeatedPass", "ModuleInlinerWrapperPass"};
+  return llvm::isSpecialPass(pass, kPassManagers);
+}
+}  // namespace
+
+void TimeReport::RegisterPassCallbacks(
+    llvm::PassInstrumentationCallbacks& callbacks) {
+  callbacks.registerBeforeNonSkippedPassCallback(
+      [this](llvm::StringRef pass, llvm::Any) {
+        if (!IsPassManager(pass)) {
+          Begin(pass);
+        }
+      });
+  callbacks.registerAfterPassCallback(
+      [this](llvm::StringRef pass, llvm::Any, const llvm::PreservedAnalyses&) {
+        if (!IsPassManager(pass)) {
+          End();
+        }
+      });
+  callbacks.registerAfterPassInvalidatedCallback(
+      [this](llvm::StringRef pass, const llvm::PreservedAnalyses&) {
+        if (!IsPassManager(pass)) {
+          End();
+        }
+      });
+}
+
+void TimeReport::Begin(llvm::StringRef name) {
+  Clock::time_point now = Clock::now();
+  if (!open_phases.empty()) {
+    OpenPhase& parent = open_phases.back();
+    parent.exclusive_seconds += Seconds(now - parent.resumed);
+  }
+  open_phases.push_back({name.str(), now, now, 0});
+}
+
+void TimeReport::End(llvm::StringRef detail) {
+  Clock::time_point now = Clock::now();
+  OpenPhase phase = std::move(open_phases.back());
+  open_phases.pop_back();
+  phase.exclusive_seconds += Seconds(now - phase.resumed);
+  if (!open_phases.empty()) {
+    open_phases.back().resumed = now;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(phases_.begin(), phases_.end(),
+                         [&](const Phase& p) { return p.name == phase.name; });
+  if (it == phases_.end()) {
+    it = phases_.insert(phases_.end(), Phase{phase.name});
+  }
+  it->seconds += phase.exclusive_seconds;
+  ++it->count;
+
+  if (!detail.empty()) {
+    items_.push_back({phase.name, detail.str(), Seconds(now - phase.start)});
+  }
+}
+
+void TimeReport::Print(llvm::raw_ostream& out) const {
+  constexpr size_t kMaxItems = 10;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<Phase> phases = phases_;
+  std::sort(phases.begin(), phases.end(), [](const Phase& a, const Phase& b) {
+    return a.seconds > b.seconds;
+  });
+  double total = 0;
+  for (const Phase& phase : phases) {
+    total += phase.seconds;
+  }
+
+  std::string rule = "===" + std::string(73, '-') + "===\n";
+  out << rule << "                          ChovL compile time report\n"
+      << rule;
+  out << llvm::format("  Total: %.4f seconds\n\n", total);
+  out << "   Time (s)       %   Count  Phase\n";
+  for (const Phase& phase : phases) {
+    double percent = total > 0 ? 100 * phase.seconds / total : 0;
+    out << llvm::format("  %9.4f  %5.1f%%  %6u  ", phase.seconds, percent,
+                        phase.count)
+        << phase.name << "\n";
+  }
+
+  if (items_.empty()) {
+    return;
+  }
+  std::vector<Item> items = items_;
+  size_t num_items = std::min(items.size(), kMaxItems);
+  std::partial_sort(
+      items.begin(), items.begin() + num_items, items.end(),
+      [](const Item& a, const Item& b) { return a.seconds > b.seconds; });
+  out << "\n  Slowest items:\n";
+  for (size_t i = 0; i < num_items; ++i) {
+    out << llvm::format("  %9.4f  ", items[i].seconds) << items[i].phase
+        << ": " << items[i].detail << "\n";
+  }
+}
+
+PhaseScope::PhaseScope(TimeReport* report, llvm::StringRef name,
+                       llvm::StringRef detail)
+    : report_(report), detail_(detail), trace_(name, detail) {
+  if (report_ != nullptr) {
+    report_->Begin(name);
+  }
+}
+
+PhaseScope::~PhaseScope() {
+  if (report_ != nullptr) {
+    report_->End(detail_);
+  }
+}
+
+}  // namespace chovl